@@ -2,6 +2,7 @@
 
 #include "actionslist.h"
 #include "primitives.h"
+#include "resultitemmodel.h"
 #include <QPainter>
 #include <albert/logging.h>
 
@@ -44,7 +45,11 @@ void ActionsListDelegate::paint(QPainter *p, const QStyleOptionViewItem &o, cons
     ItemDelegateBase::paint(p, o, i);
 
     // Elide text
-    auto text = i.data(Qt::DisplayRole).toString();
+    QString text;
+    if (const auto *provider = dynamic_cast<const RowViewProvider*>(i.model()); provider)
+        text = provider->rowView(i.row()).text;
+    else
+        text = i.data(Qt::DisplayRole).toString();
     text = p->fontMetrics().elidedText(text, o.textElideMode, o.rect.width());
 
     QTextOption text_option;
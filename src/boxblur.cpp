@@ -0,0 +1,265 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "boxblur.h"
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BOXBLUR_X86
+#include <immintrin.h>
+#endif
+using namespace std;
+
+namespace {
+
+// 16 bit accumulators hold at most 255 * 255
+const int max_box_radius = 127;
+
+// Images smaller than this are not worth the thread overhead
+const qsizetype min_parallel_pixels = 256 * 256;
+
+// Columns per strip are kept a multiple of a cache line
+const int strip_alignment = 64;
+
+///
+/// Advances the vertical running sums of one row by n columns.
+///
+/// Writes the current box averages to out, then adds the row entering and subtracts the row
+/// leaving the box. The division by the box size is a multiplication by m = 2^16 / size.
+///
+using RowStep = void (*)(quint16 *acc, const uchar *in, const uchar *old, uchar *out,
+                         int n, quint16 m);
+
+void rowStepScalar(quint16 *acc, const uchar *in, const uchar *old, uchar *out, int n, quint16 m)
+{
+    for (int x = 0; x < n; ++x)
+    {
+        out[x] = (uchar)min(255u, ((uint)acc[x] * m) >> 16);
+        acc[x] = acc[x] + in[x] - old[x];
+    }
+}
+
+#if defined(__SSE2__)
+void rowStepSse2(quint16 *acc, const uchar *in, const uchar *old, uchar *out, int n, quint16 m)
+{
+    const auto zero = _mm_setzero_si128();
+    const auto mv = _mm_set1_epi16((short)m);
+    int x = 0;
+    for (; x + 8 <= n; x += 8)
+    {
+        const auto a = _mm_loadu_si128((const __m128i*)(acc + x));
+        const auto o = _mm_mulhi_epu16(a, mv);
+        _mm_storel_epi64((__m128i*)(out + x), _mm_packus_epi16(o, o));
+        const auto i = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(in + x)), zero);
+        const auto d = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(old + x)), zero);
+        _mm_storeu_si128((__m128i*)(acc + x), _mm_sub_epi16(_mm_add_epi16(a, i), d));
+    }
+    rowStepScalar(acc + x, in + x, old + x, out + x, n - x, m);
+}
+#endif
+
+#if defined(BOXBLUR_X86)
+__attribute__((target("avx2")))
+void rowStepAvx2(quint16 *acc, const uchar *in, const uchar *old, uchar *out, int n, quint16 m)
+{
+    const auto mv = _mm256_set1_epi16((short)m);
+    int x = 0;
+    for (; x + 16 <= n; x += 16)
+    {
+        const auto a = _mm256_loadu_si256((const __m256i*)(acc + x));
+        const auto o = _mm256_mulhi_epu16(a, mv);
+        _mm_storeu_si128((__m128i*)(out + x),
+                         _mm_packus_epi16(_mm256_castsi256_si128(o),
+                                          _mm256_extracti128_si256(o, 1)));
+        const auto i = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(in + x)));
+        const auto d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(old + x)));
+        _mm256_storeu_si256((__m256i*)(acc + x), _mm256_sub_epi16(_mm256_add_epi16(a, i), d));
+    }
+    rowStepScalar(acc + x, in + x, old + x, out + x, n - x, m);
+}
+#endif
+
+RowStep rowStep(BoxBlurKernel kernel)
+{
+    switch (kernel) {
+    case BoxBlurKernel::Auto:
+#if defined(BOXBLUR_X86)
+        if (__builtin_cpu_supports("avx2"))
+            return rowStepAvx2;
+#endif
+#if defined(__SSE2__)
+        return rowStepSse2;
+#else
+        return rowStepScalar;
+#endif
+#if defined(BOXBLUR_X86)
+    case BoxBlurKernel::Avx2:
+        return rowStepAvx2;
+#endif
+#if defined(__SSE2__)
+    case BoxBlurKernel::Sse2:
+        return rowStepSse2;
+#endif
+    default:
+        return rowStepScalar;
+    }
+}
+
+const RowStep auto_row_step = rowStep(BoxBlurKernel::Auto);
+
+// Box radii approximating a gaussian of sigma by three box blurs (W. Jarosz, Fast image
+// convolutions). The sum of the box variances matches the gaussian variance.
+array<int, 3> boxRadii(double sigma)
+{
+    const int n = 3;
+    int wl = (int)floor(sqrt(12 * sigma * sigma / n + 1));
+    if (wl % 2 == 0)
+        --wl;
+    const int wu = wl + 2;
+    const int m = (int)round((12 * sigma * sigma - n * wl * wl - 4 * n * wl - 3 * n)
+                             / (-4 * wl - 4));
+    array<int, 3> radii;
+    for (int i = 0; i < n; ++i)
+        radii[i] = min(max_box_radius, ((i < m ? wl : wu) - 1) / 2);
+    return radii;
+}
+
+// Vertical box blur of the columns [x0, x1), rows outside the image are treated as transparent
+void blurColumns(RowStep row_step, const uchar *src, uchar *dst, qsizetype bpl,
+                 int x0, int x1, int height, int r)
+{
+    const int n = x1 - x0;
+    const auto m = (quint16)((65536 + 2 * r) / (2 * r + 1));  // rounded up, keeps opaque areas opaque
+    vector<quint16> acc(n, 0);
+    vector<uchar> zeros(n, 0);
+    vector<uchar> scratch(n);
+
+    for (int y = 0; y <= r && y < height; ++y)
+        row_step(acc.data(), src + y * bpl + x0, zeros.data(), scratch.data(), n, m);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const auto *in = y + r + 1 < height ? src + (y + r + 1) * bpl + x0 : zeros.data();
+        const auto *old = y >= r ? src + (y - r) * bpl + x0 : zeros.data();
+        row_step(acc.data(), in, old, dst + y * bpl + x0, n, m);
+    }
+}
+
+// Runs the vertical passes, the result ends up in dst
+void blurVertically(QImage &src, QImage &dst, const array<int, 3> &radii, bool parallel,
+                    RowStep row_step)
+{
+    const auto w = src.width();
+    const auto h = src.height();
+    const auto bpl = src.bytesPerLine();
+    auto *a = src.bits();
+    auto *b = dst.bits();
+
+    // Columns are independent, each strip runs all passes without synchronization
+    auto blurStrip = [=](int x0, int x1)
+    {
+        uchar *s = a;
+        uchar *d = b;
+        for (auto r : radii)
+            if (r > 0)
+            {
+                blurColumns(row_step, s, d, bpl, x0, x1, h, r);
+                swap(s, d);
+            }
+    };
+
+    const int passes = (int)count_if(radii.begin(), radii.end(), [](int r){ return r > 0; });
+
+    int strips = 1;
+    if (parallel && (qsizetype)w * h >= min_parallel_pixels)
+        strips = max(1, min(QThread::idealThreadCount(), w / (2 * strip_alignment)));
+
+    if (strips == 1)
+        blurStrip(0, w);
+    else
+    {
+        const int strip_width = (w / strips + strip_alignment - 1)
+                                / strip_alignment * strip_alignment;
+        QThreadPool pool;
+        pool.setMaxThreadCount(strips - 1);
+        int x0 = strip_width;
+        for (; x0 + strip_width < w; x0 += strip_width)
+            pool.start([=]{ blurStrip(x0, x0 + strip_width); });
+        pool.start([=]{ blurStrip(x0, w); });
+        blurStrip(0, strip_width);
+        pool.waitForDone();
+    }
+
+    if (passes % 2 == 0)
+        swap(src, dst);  // results are in src, callers expect them in dst
+}
+
+QImage transposed(const QImage &src)
+{
+    const int block = 16;
+    const auto w = src.width();
+    const auto h = src.height();
+    QImage dst(h, w, QImage::Format_Alpha8);
+    const auto *s = src.constBits();
+    auto *d = dst.bits();
+    const auto sbpl = src.bytesPerLine();
+    const auto dbpl = dst.bytesPerLine();
+    for (int y0 = 0; y0 < h; y0 += block)
+        for (int x0 = 0; x0 < w; x0 += block)
+            for (int y = y0; y < min(y0 + block, h); ++y)
+                for (int x = x0; x < min(x0 + block, w); ++x)
+                    d[x * dbpl + y] = s[y * sbpl + x];
+    return dst;
+}
+
+}
+
+bool boxBlurKernelSupported(BoxBlurKernel kernel)
+{
+    switch (kernel) {
+    case BoxBlurKernel::Auto:
+    case BoxBlurKernel::Scalar:
+        return true;
+    case BoxBlurKernel::Sse2:
+#if defined(__SSE2__)
+        return true;
+#else
+        return false;
+#endif
+    case BoxBlurKernel::Avx2:
+#if defined(BOXBLUR_X86)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+void boxBlurAlpha8(QImage &image, int radius, bool parallel, BoxBlurKernel kernel)
+{
+    Q_ASSERT(image.format() == QImage::Format_Alpha8);
+    Q_ASSERT(boxBlurKernelSupported(kernel));
+
+    if (radius <= 0 || image.isNull())
+        return;
+
+    const auto radii = boxRadii(radius / 2.0);
+    const auto row_step = kernel == BoxBlurKernel::Auto ? auto_row_step : rowStep(kernel);
+    const auto dpr = image.devicePixelRatio();
+
+    // Vertical passes
+    QImage tmp(image.size(), QImage::Format_Alpha8);
+    blurVertically(image, tmp, radii, parallel, row_step);
+
+    // Horizontal passes, rows are made columns such that the kernels work on contiguous memory
+    auto t = transposed(tmp);
+    tmp = QImage(t.size(), QImage::Format_Alpha8);
+    blurVertically(t, tmp, radii, parallel, row_step);
+
+    image = transposed(tmp);
+    image.setDevicePixelRatio(dpr);
+}
@@ -0,0 +1,25 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QImage>
+
+/// The vectorized kernels of the box blur. Auto selects the fastest kernel the CPU supports.
+enum class BoxBlurKernel { Auto, Scalar, Sse2, Avx2 };
+
+/// Returns true if kernel can be used on this CPU.
+bool boxBlurKernelSupported(BoxBlurKernel kernel);
+
+///
+/// Blurs an alpha mask in place.
+///
+/// Approximates a gaussian by three successive box blurs per axis. The kernels use AVX2 or SSE2
+/// if available and fall back to scalar code otherwise. `radius` is in device pixels and matches
+/// the visual extent of `qt_blurImage`. If `parallel` is set large images are blurred in column
+/// strips on multiple threads. All kernels produce identical results, `kernel` is meant for
+/// testing and benchmarking.
+///
+/// \pre image is of format QImage::Format_Alpha8.
+/// \pre kernel is supported.
+///
+void boxBlurAlpha8(QImage &image, int radius, bool parallel = false,
+                   BoxBlurKernel kernel = BoxBlurKernel::Auto);
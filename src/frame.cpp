@@ -9,9 +9,17 @@ Frame::Frame(QWidget *parent):
     border_brush_(Qt::transparent),
     fill_brush_(palette().color(QPalette::Window)),
     border_width_(0),
-    radius_(0)
+    radius_(0),
+    generation_(0),
+    pixmap_generation_(0)
 {
     setMinimumSize(0,0);
+
+    auto invalidate = [this]{ ++generation_; };
+    connect(this, &Frame::borderBrushChanged, this, invalidate);
+    connect(this, &Frame::borderWidthChanged, this, invalidate);
+    connect(this, &Frame::fillBrushChanged, this, invalidate);
+    connect(this, &Frame::radiusChanged, this, invalidate);
 }
 
 double Frame::borderWidth() const
@@ -77,15 +85,23 @@ void Frame::setBorderBrush(QBrush boarderBrush)
 void Frame::paintEvent(QPaintEvent*)
 {
     auto dpr = devicePixelRatioF();
-    QPixmap pm = pixelPerfectRoundedRect(size() * dpr,
-                                         fill_brush_,
-                                         (int)(radius_ * dpr),
-                                         border_brush_,
-                                         (int)(border_width_ * dpr));
-    pm.setDevicePixelRatio(dpr);
+    if (pixmap_.isNull()
+        || pixmap_generation_ != generation_
+        || pixmap_.devicePixelRatio() != dpr
+        || pixmap_size_ != size())
+    {
+        pixmap_ = pixelPerfectRoundedRect(size() * dpr,
+                                          fill_brush_,
+                                          (int)(radius_ * dpr),
+                                          border_brush_,
+                                          (int)(border_width_ * dpr));
+        pixmap_.setDevicePixelRatio(dpr);
+        pixmap_size_ = size();
+        pixmap_generation_ = generation_;
+    }
 
     QPainter p(this);
-    p.drawPixmap(rect(), pm);
+    p.drawPixmap(rect(), pixmap_);
 }
 
 QSize Frame::minimumSizeHint() const { return {-1, -1}; }
@@ -37,6 +37,12 @@ private:
     double border_width_;
     double radius_;
 
+    // Backing pixmap, valid as long as generation, size and dpr match
+    QPixmap pixmap_;
+    QSize pixmap_size_;
+    uint generation_;
+    uint pixmap_generation_;
+
 signals:
 
     void borderBrushChanged(const QBrush&);
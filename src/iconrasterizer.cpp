@@ -0,0 +1,153 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "iconrasterizer.h"
+#include <QImageReader>
+#include <QPainter>
+#include <QUrl>
+#include <albert/logging.h>
+#include <chrono>
+using namespace Qt::StringLiterals;
+using namespace std::chrono;
+
+namespace {
+
+// Time the GUI thread spends painting icons per event loop iteration
+const milliseconds render_budget{4};
+
+// Reads the image at path scaled to fit a square of size device pixels. Thread safe.
+QImage readImage(const QString &path, int size)
+{
+    QImageReader reader(path);
+
+    // Like QIcon, scale down but do not scale up raster images
+    const auto image_size = reader.size();
+    const auto scalable = reader.format() == "svg" || reader.format() == "svgz";
+    if (!image_size.isValid())
+        reader.setScaledSize({size, size});
+    else if (scalable || image_size.width() > size || image_size.height() > size)
+        reader.setScaledSize(image_size.scaled(size, size, Qt::KeepAspectRatio));
+
+    return reader.read();
+}
+
+}
+
+IconRasterizer::IconRasterizer(QObject *parent) : QObject(parent)
+{
+    thread_pool_.setMaxThreadCount(2);  // Decoding is mostly io bound
+
+    render_timer_.setSingleShot(true);
+    render_timer_.setInterval(0);
+    connect(&render_timer_, &QTimer::timeout, this, &IconRasterizer::renderQueued);
+}
+
+IconRasterizer::~IconRasterizer()
+{
+    thread_pool_.clear();
+    thread_pool_.waitForDone();
+}
+
+bool IconRasterizer::isPending(const IconKey &key) const { return pending_.contains(key); }
+
+QString IconRasterizer::imagePath(const QString &icon_source)
+{
+    const QUrl url(icon_source);
+    if (url.isLocalFile())
+        return url.toLocalFile();
+    else if (url.scheme() == u"qrc"_s)
+        return u":"_s + url.path();
+    else
+        return {};
+}
+
+QImage IconRasterizer::paint(const IconKey &key, const QIcon &icon)
+{
+    QImage image(QSize(key.size, key.size) * key.dpr, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(key.dpr);
+    image.fill(Qt::transparent);
+    QPainter p(&image);
+    icon.paint(&p, QRect(0, 0, key.size, key.size));
+    return image;
+}
+
+void IconRasterizer::decode(const IconKey &key, const QString &path, const QIcon &icon)
+{
+    if (pending_.contains(key))
+        return;
+
+    pending_.insert(key, icon);
+
+    thread_pool_.start([this, key, path]
+    {
+        auto tp = system_clock::now();
+
+        const auto device_size = (int)(key.size * key.dpr);
+        QImage image;
+        if (const auto decoded = readImage(path, device_size); !decoded.isNull())
+        {
+            // Center into a square, like QIcon::paint does
+            image = QImage(device_size, device_size, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+            QPainter p(&image);
+            p.drawImage((device_size - decoded.width()) / 2,
+                        (device_size - decoded.height()) / 2,
+                        decoded);
+            p.end();
+            image.setDevicePixelRatio(key.dpr);
+        }
+
+        if (auto dur = duration_cast<milliseconds>(system_clock::now() - tp).count(); dur > 5)
+            WARN << u"Slow icon decoding: %1 ms - %2"_s.arg(dur).arg(path);
+
+        QMetaObject::invokeMethod(this, [this, key, image]
+        {
+            if (image.isNull())
+                enqueueRender(key);
+            else
+            {
+                pending_.remove(key);
+                emit finished(key, image);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void IconRasterizer::render(const IconKey &key, const QIcon &icon)
+{
+    if (pending_.contains(key))
+        return;
+
+    pending_.insert(key, icon);
+    enqueueRender(key);
+}
+
+void IconRasterizer::enqueueRender(const IconKey &key)
+{
+    render_queue_.append(key);
+    if (!render_timer_.isActive())
+        render_timer_.start();
+}
+
+void IconRasterizer::renderQueued()
+{
+    const auto begin = system_clock::now();
+
+    while (!render_queue_.isEmpty() && system_clock::now() - begin < render_budget)
+    {
+        const auto key = render_queue_.takeFirst();
+        const auto icon = pending_.take(key);
+
+        auto tp = system_clock::now();
+
+        const auto image = paint(key, icon);
+
+        if (auto dur = duration_cast<milliseconds>(system_clock::now() - tp).count(); dur > 5)
+            WARN << u"Slow icon rendering: %1 ms - %2"_s.arg(dur).arg(key.source);
+
+        emit finished(key, image);
+    }
+
+    // Leave the remaining icons for the next iteration, let paint and input events in first
+    if (!render_queue_.isEmpty())
+        render_timer_.start();
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include "rendercache.h"
+#include <QHash>
+#include <QIcon>
+#include <QImage>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+
+///
+/// Rasterizes icons without blocking the GUI thread on slow image files.
+///
+/// Threading contract: QIcon is not thread safe, its engines and caches are used on the GUI
+/// thread only. The worker pool only reads and decodes image files using QImageReader, which
+/// does not touch any QIcon. Icons not backed by an image file are painted on the GUI thread,
+/// queued to the event loop in time boxed batches such that paint events are never blocked.
+/// All members have to be called on the GUI thread, results are delivered there using the
+/// finished signal.
+///
+class IconRasterizer : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    IconRasterizer(QObject *parent = nullptr);
+    ~IconRasterizer();
+
+    bool isPending(const IconKey &key) const;
+
+    /// Returns the path of the image file of an icon source or a null string if the icon is
+    /// not backed by an image file.
+    static QString imagePath(const QString &icon_source);
+
+    /// Paints icon centered into a square image of the key size. GUI thread only.
+    static QImage paint(const IconKey &key, const QIcon &icon);
+
+    /// Schedules decoding of the image file at path on the worker pool. If the file can not be
+    /// decoded, icon is rendered instead. No-op if key is pending already.
+    void decode(const IconKey &key, const QString &path, const QIcon &icon);
+
+    /// Schedules painting icon on the GUI thread. No-op if key is pending already.
+    void render(const IconKey &key, const QIcon &icon);
+
+private:
+
+    void enqueueRender(const IconKey &key);
+    void renderQueued();
+
+    QThreadPool thread_pool_;
+    QHash<IconKey, QIcon> pending_;  // fallback icons, never passed to the workers
+    QList<IconKey> render_queue_;
+    QTimer render_timer_;
+
+signals:
+
+    void finished(const IconKey &key, const QImage &image);
+
+};
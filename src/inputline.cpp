@@ -89,6 +89,9 @@ InputLine::InputLine(QWidget *parent):
         user_text_ = text();
     });
 
+    // Not textEdited, which is disconnected while setting text
+    connect(this, &QPlainTextEdit::textChanged, this, &InputLine::invalidateHint);
+
     // auto fixHeight = [this]{
     //     INFO << "INPUTLINE fm lineSpacing" << fontMetrics().lineSpacing();
     //     INFO << "INPUTLINE doc height" << document()->size().height();
@@ -114,6 +117,7 @@ const QString &InputLine::synopsis() const { return synopsis_; }
 void InputLine::setSynopsis(const QString &t)
 {
     synopsis_ = t;
+    invalidateHint();
     update();
 }
 
@@ -122,6 +126,7 @@ const QString &InputLine::completion() const { return completion_; }
 void InputLine::setCompletion(const QString &t)
 {
     completion_ = t;
+    invalidateHint();
     update();
 }
 
@@ -131,6 +136,7 @@ void InputLine::setTriggerLength(uint len)
 {
     trigger_length_ = len;
     highlighter_->rehighlight();
+    invalidateHint();  // the text advance changed
 }
 
 QString InputLine::text() const { return toPlainText(); }
@@ -160,6 +166,7 @@ void InputLine::setFontSize(uint val)
     f.setPointSize(val);
     setFont(f);
     highlighter_->rehighlight(); // required because it sets hint advance
+    invalidateHint();
 
     // setFixedHeight(fontMetrics().lineSpacing() + 2 * (int)document()->documentMargin());
 }
@@ -225,43 +232,76 @@ void InputLine::previous()
     setText(t.isNull() ? user_text_ : t);  // restore text at end
 }
 
-void InputLine::paintEvent(QPaintEvent *event)
+const InputLine::HintLayout &InputLine::hintLayout()
 {
-    if (document()->size().height() == 1
-        && !(synopsis_.isEmpty() && completion_.isEmpty()))
+    if (hint_.valid)
+        return hint_;
+
+    QString c = completion();
+    if (auto query = text().mid(trigger_length_);
+        completion().startsWith(query, Qt::CaseInsensitive))
+        c = completion().mid(query.length());
+    else
+        c.prepend(QChar::Space);
+
+    auto r = QRectF(contentsRect()).adjusted(highlighter_->formatted_text_length + 1,
+                                             1, -1, -1); // 1xp document margin
+    auto c_width = fontMetrics().horizontalAdvance(c);
+    if (c_width > r.width())
     {
+        c = fontMetrics().elidedText(c, Qt::ElideRight, (int)r.width());
+        c_width = fontMetrics().horizontalAdvance(c);
+    }
 
-        QString c = completion();
-        if (auto query = text().mid(trigger_length_);
-            completion().startsWith(query, Qt::CaseInsensitive))
-            c = completion().mid(query.length());
-        else
-            c.prepend(QChar::Space);
-
-        auto r = QRectF(contentsRect()).adjusted(highlighter_->formatted_text_length + 1,
-                                                 1, -1, -1); // 1xp document margin
-        auto c_width = fontMetrics().horizontalAdvance(c);
-        if (c_width > r.width())
-        {
-            c = fontMetrics().elidedText(c, Qt::ElideRight, (int)r.width());
-            c_width = fontMetrics().horizontalAdvance(c);
-        }
+    const auto synopsis_width =
+        synopsis_.isEmpty() ? 0 : fontMetrics().horizontalAdvance(synopsis());
+    const auto draw_synopsis = synopsis_width > 0 && synopsis_width + c_width < r.width();
+
+    // The ink of the glyphs, including bearings but excluding the leading space. A damage rect
+    // not intersecting it, e.g. the cursor rect while blinking, does not require the hint.
+    QRectF bounds;
+    const QFontMetricsF fm(font());
+    const auto baseline = r.top() + fm.ascent();
+    if (const auto lead = c.startsWith(QChar::Space) ? 1 : 0; c.size() > lead)
+        bounds = fm.boundingRect(c.mid(lead))
+                     .translated(r.left() + fm.horizontalAdvance(c.left(lead)), baseline);
+    if (draw_synopsis)
+    {
+        auto f = font();
+        f.setWeight(QFont::Light);
+        const QFontMetricsF sfm(f);
+        bounds |= sfm.boundingRect(synopsis_)
+                      .translated(r.right() - sfm.horizontalAdvance(synopsis_),
+                                  r.top() + sfm.ascent());
+    }
+
+    hint_ = {true, r, c, c_width, draw_synopsis, bounds.toAlignedRect()};
+    return hint_;
+}
 
-        QPainter p(viewport());
-        p.setPen(hint_color_);
-        p.drawText(r, Qt::TextSingleLine, c);
+void InputLine::invalidateHint() { hint_.valid = false; }
 
-        if (synopsis_.length() > 0)
+void InputLine::paintEvent(QPaintEvent *event)
+{
+    // Cursor blinks only damage the cursor rect, skip the hint unless its ink has been damaged
+    if (document()->size().height() == 1
+        && !(synopsis_.isEmpty() && completion_.isEmpty()))
+        if (const auto &h = hintLayout(); event->rect().intersects(h.bounds))
         {
-            auto f = font();
-            f.setWeight(QFont::Light);
-            p.setFont(f);
-            if (fontMetrics().horizontalAdvance(synopsis()) + c_width < r.width())
-                p.drawText(r.adjusted(c_width, 0, 0, 0),
+            QPainter p(viewport());
+            p.setPen(hint_color_);
+            p.drawText(h.rect, Qt::TextSingleLine, h.completion);
+
+            if (h.draw_synopsis)
+            {
+                auto f = font();
+                f.setWeight(QFont::Light);
+                p.setFont(f);
+                p.drawText(h.rect.adjusted(h.completion_width, 0, 0, 0),
                            Qt::TextSingleLine | Qt::AlignRight,
                            synopsis());
+            }
         }
-    }
 
 
     // qreal bearing_diff = 0;
@@ -281,6 +321,19 @@ void InputLine::paintEvent(QPaintEvent *event)
     QPlainTextEdit::paintEvent(event);
 }
 
+void InputLine::resizeEvent(QResizeEvent *event)
+{
+    invalidateHint();
+    QPlainTextEdit::resizeEvent(event);
+}
+
+void InputLine::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::FontChange)
+        invalidateHint();
+    QPlainTextEdit::changeEvent(event);
+}
+
 void InputLine::hideEvent(QHideEvent *event)
 {
     history_.add(text());
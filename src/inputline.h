@@ -45,6 +45,8 @@ public:
 private:
 
     void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
     void hideEvent(QHideEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
     void inputMethodEvent(QInputMethodEvent *event) override;
@@ -59,6 +61,21 @@ private:
     QColor hint_color_;
     QColor trigger_color_;
 
+    // Laid out completion and synopsis. Cached such that repaints of the blinking cursor do
+    // not measure and elide the hint text.
+    struct HintLayout
+    {
+        bool valid = false;
+        QRectF rect;  // right of the text
+        QString completion;  // elided
+        int completion_width = 0;
+        bool draw_synopsis = false;
+        QRect bounds;  // ink of the hint, the hint is skipped for damage outside
+    };
+    const HintLayout &hintLayout();
+    void invalidateHint();
+    HintLayout hint_;
+
 signals:
 
     void textEdited();
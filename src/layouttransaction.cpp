@@ -0,0 +1,112 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "layouttransaction.h"
+#include <QLayout>
+#include <QPointer>
+#include <QTimer>
+#include <QWidget>
+#include <vector>
+using namespace std;
+
+namespace {
+
+struct Request
+{
+    QPointer<QObject> receiver;
+    int key;
+    function<void()> f;
+};
+
+struct State
+{
+    int depth = 0;
+    bool flush_scheduled = false;
+    vector<QPointer<QWidget>> windows;  // suspended by this transaction
+    vector<Request> requests;
+};
+
+State &state()
+{
+    static State s;
+    return s;
+}
+
+void suspend(QWidget *window)
+{
+    auto &s = state();
+    for (const auto &w : s.windows)
+        if (w == window)
+            return;
+
+    // Do not take over windows suspended by someone else
+    if (!window->updatesEnabled() || (window->layout() && !window->layout()->isEnabled()))
+        return;
+
+    window->setUpdatesEnabled(false);  // implicitly disables the updates of the children
+    if (window->layout())
+        window->layout()->setEnabled(false);
+    s.windows.emplace_back(window);
+}
+
+void flush()
+{
+    auto &s = state();
+    s.flush_scheduled = false;
+    if (s.depth > 0)
+        return;  // a new transaction has been opened, its commit flushes
+
+    for (auto requests = std::move(s.requests); auto &r : requests)
+        if (r.receiver)
+            r.f();
+
+    for (auto windows = std::move(s.windows); auto &w : windows)
+        if (w)
+        {
+            if (auto *l = w->layout(); l)
+            {
+                l->setEnabled(true);
+                l->invalidate();
+                l->activate();
+            }
+            w->setUpdatesEnabled(true);  // schedules a repaint
+        }
+}
+
+}
+
+LayoutTransaction::LayoutTransaction(QWidget *window)
+{
+    ++state().depth;
+    suspend(window);
+}
+
+LayoutTransaction::~LayoutTransaction()
+{
+    auto &s = state();
+    if (--s.depth == 0 && !s.flush_scheduled)
+    {
+        s.flush_scheduled = true;
+        QTimer::singleShot(0, &flush);
+    }
+}
+
+bool LayoutTransaction::isOpen()
+{
+    const auto &s = state();
+    return s.depth > 0 || s.flush_scheduled;
+}
+
+void LayoutTransaction::request(QObject *receiver, int key, function<void()> f)
+{
+    if (!isOpen())
+        return f();
+
+    auto &s = state();
+    for (auto &r : s.requests)
+        if (r.receiver == receiver && r.key == key)
+        {
+            r.f = std::move(f);
+            return;
+        }
+    s.requests.push_back({receiver, key, std::move(f)});
+}
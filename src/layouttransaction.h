@@ -0,0 +1,35 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QtGlobal>
+#include <functional>
+class QObject;
+class QWidget;
+
+///
+/// Batches geometry and repaint requests of a window into a single pass.
+///
+/// Begins on construction and commits on destruction. Transactions nest. While a transaction
+/// is open the layout and the updates of the window are disabled and requests passed to
+/// `request` are queued. When the outermost transaction commits, the queued requests are run
+/// on the next event loop iteration, followed by a single layout activation and repaint.
+///
+class LayoutTransaction
+{
+public:
+
+    explicit LayoutTransaction(QWidget *window);
+    ~LayoutTransaction();
+
+    /// Returns true if requests are deferred, i.e. a transaction is open or not yet flushed.
+    static bool isOpen();
+
+    /// Runs `f` when the transactions are flushed or immediately if no transaction is open.
+    /// Requests of the same receiver and key are merged. Dropped if receiver is destroyed.
+    static void request(QObject *receiver, int key, std::function<void()> f);
+
+private:
+
+    Q_DISABLE_COPY_MOVE(LayoutTransaction)
+
+};
@@ -0,0 +1,83 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "rendercache.h"
+using namespace Qt::StringLiterals;
+
+namespace {
+
+const qsizetype icons_budget       = 32 * 1024 * 1024;
+const qsizetype selections_budget  =  2 * 1024 * 1024;
+const qsizetype frames_budget      = 16 * 1024 * 1024;
+const qsizetype shadows_budget     =  4 * 1024 * 1024;
+const qsizetype row_layouts_budget =  2 * 1024 * 1024;
+
+// QStaticText does not expose its size. Estimate glyph indices, positions and items.
+const qsizetype row_layout_bytes_per_char = 32;
+const qsizetype row_layout_overhead = 512;
+
+template<typename Key, typename T>
+QString formatStats(const QString &name, const LruCache<Key, T> &c)
+{
+    return u"%1: %2 entries, %3/%4 KiB, %5 hits, %6 misses, %7 evictions"_s
+        .arg(name)
+        .arg(c.count())
+        .arg(c.bytes() / 1024)
+        .arg(c.budget() / 1024)
+        .arg(c.stats().hits)
+        .arg(c.stats().misses)
+        .arg(c.stats().evictions);
+}
+
+}
+
+RenderCache::RenderCache():
+    icons(icons_budget),
+    selections(selections_budget),
+    frames(frames_budget),
+    shadows(shadows_budget),
+    row_layouts(row_layouts_budget)
+{}
+
+RenderCache &RenderCache::instance()
+{
+    static RenderCache render_cache;
+    return render_cache;
+}
+
+qsizetype RenderCache::cost(const QPixmap &pm)
+{ return (qsizetype)pm.width() * pm.height() * pm.depth() / 8; }
+
+qsizetype RenderCache::cost(const QImage &image) { return image.sizeInBytes(); }
+
+qsizetype RenderCache::cost(const RowLayout &l)
+{ return row_layout_overhead + (l.text.size() + l.subtext.size()) * row_layout_bytes_per_char; }
+
+void RenderCache::clear()
+{
+    icons.clear();
+    selections.clear();
+    frames.clear();
+    shadows.clear();
+    row_layouts.clear();
+}
+
+void RenderCache::trim(qsizetype bytes)
+{
+    const auto total_budget = icons.budget() + selections.budget() + frames.budget()
+                              + shadows.budget() + row_layouts.budget();
+    const auto share = [&](qsizetype budget){ return bytes * budget / total_budget; };
+    icons.trim(share(icons.budget()));
+    selections.trim(share(selections.budget()));
+    frames.trim(share(frames.budget()));
+    shadows.trim(share(shadows.budget()));
+    row_layouts.trim(share(row_layouts.budget()));
+}
+
+QString RenderCache::report() const
+{
+    return QStringList{formatStats(u"Icons"_s, icons),
+                       formatStats(u"Selections"_s, selections),
+                       formatStats(u"Frames"_s, frames),
+                       formatStats(u"Shadows"_s, shadows),
+                       formatStats(u"Row layouts"_s, row_layouts)}.join(u'\n');
+}
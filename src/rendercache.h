@@ -0,0 +1,241 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QFont>
+#include <QHash>
+#include <QPixmap>
+#include <QStaticText>
+#include <list>
+
+///
+/// Least recently used cache with a byte budget.
+///
+/// Entries are evicted in least recently used order once the accumulated cost exceeds the budget.
+/// The most recently inserted entry is never evicted by its own insertion.
+///
+template<typename Key, typename T>
+class LruCache
+{
+public:
+
+    struct Stats
+    {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+    };
+
+    explicit LruCache(qsizetype budget) : budget_(budget) {}
+
+    /// Returns the value for key or nullptr and marks the entry as most recently used.
+    const T *find(const Key &key)
+    {
+        if (auto it = index_.find(key); it != index_.end())
+        {
+            entries_.splice(entries_.begin(), entries_, it.value());
+            ++stats_.hits;
+            return &it.value()->value;
+        }
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    /// Inserts or replaces the value for key. Returns a reference to the stored value.
+    const T &insert(const Key &key, T value, qsizetype cost)
+    {
+        remove(key);
+        entries_.push_front({key, std::move(value), cost});
+        index_.insert(key, entries_.begin());
+        bytes_ += cost;
+        trim(budget_);
+        return entries_.front().value;
+    }
+
+    bool remove(const Key &key)
+    {
+        if (auto it = index_.find(key); it != index_.end())
+        {
+            bytes_ -= it.value()->cost;
+            entries_.erase(it.value());
+            index_.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    /// Removes all entries whose key satisfies pred. Used for targeted invalidation.
+    template<typename Predicate>
+    void removeIf(Predicate pred)
+    {
+        for (auto it = entries_.begin(); it != entries_.end();)
+            if (pred(it->key))
+            {
+                bytes_ -= it->cost;
+                index_.remove(it->key);
+                it = entries_.erase(it);
+            }
+            else
+                ++it;
+    }
+
+    /// Evicts least recently used entries until the cost is at most bytes.
+    void trim(qsizetype bytes)
+    {
+        while (bytes_ > bytes && entries_.size() > 1)
+        {
+            bytes_ -= entries_.back().cost;
+            index_.remove(entries_.back().key);
+            entries_.pop_back();
+            ++stats_.evictions;
+        }
+    }
+
+    void clear()
+    {
+        index_.clear();
+        entries_.clear();
+        bytes_ = 0;
+    }
+
+    qsizetype bytes() const { return bytes_; }
+
+    qsizetype budget() const { return budget_; }
+
+    void setBudget(qsizetype budget) { budget_ = budget; trim(budget_); }
+
+    qsizetype count() const { return index_.size(); }
+
+    const Stats &stats() const { return stats_; }
+
+private:
+
+    struct Entry
+    {
+        Key key;
+        T value;
+        qsizetype cost;
+    };
+
+    std::list<Entry> entries_;  // most recently used first
+    QHash<Key, typename std::list<Entry>::iterator> index_;
+    qsizetype bytes_ = 0;
+    qsizetype budget_;
+    Stats stats_;
+
+};
+
+
+struct IconKey
+{
+    QString source;  // See IconSourceRole
+    int size;
+    qreal dpr;
+
+    bool operator==(const IconKey &) const = default;
+};
+
+inline size_t qHash(const IconKey &k, size_t seed = 0)
+{ return qHashMulti(seed, k.source, k.size, k.dpr); }
+
+
+struct SelectionKey
+{
+    const void *owner;  // The delegate, which holds the selection brushes
+    QSize size;
+    qreal dpr;
+
+    bool operator==(const SelectionKey &) const = default;
+};
+
+inline size_t qHash(const SelectionKey &k, size_t seed = 0)
+{ return qHashMulti(seed, k.owner, k.size.width(), k.size.height(), k.dpr); }
+
+
+struct FrameKey
+{
+    enum Part { Composite, Body, Shadow };
+
+    const void *owner;  // The frame widget, which holds the brushes
+    Part part;
+    QSize size;
+    qreal dpr;
+
+    bool operator==(const FrameKey &) const = default;
+};
+
+inline size_t qHash(const FrameKey &k, size_t seed = 0)
+{ return qHashMulti(seed, k.owner, k.part, k.size.width(), k.size.height(), k.dpr); }
+
+
+struct ShadowKey
+{
+    int radius;
+    int size;
+    qreal dpr;
+
+    bool operator==(const ShadowKey &) const = default;
+};
+
+inline size_t qHash(const ShadowKey &k, size_t seed = 0)
+{ return qHashMulti(seed, k.radius, k.size, k.dpr); }
+
+
+struct RowLayoutKey
+{
+    QString identifier;
+    QFont text_font;
+    QFont subtext_font;
+    int width;
+    qreal dpr;
+
+    bool operator==(const RowLayoutKey &) const = default;
+};
+
+inline size_t qHash(const RowLayoutKey &k, size_t seed = 0)
+{ return qHashMulti(seed, k.identifier, k.text_font, k.subtext_font, k.width, k.dpr); }
+
+struct RowLayout
+{
+    QString text;  // source, used to validate hits
+    QString subtext;  // source, used to validate hits
+    QStaticText static_text;
+    QStaticText static_subtext;
+};
+
+
+///
+/// The render cache of the frontend.
+///
+/// Unlike the process global QPixmapCache it is not shared with other plugins. Every category has
+/// its own budget, such that e.g. a large result set can not evict the window frame.
+///
+class RenderCache
+{
+public:
+
+    static RenderCache &instance();
+
+    static qsizetype cost(const QPixmap &pixmap);
+    static qsizetype cost(const QImage &image);
+    static qsizetype cost(const RowLayout &layout);
+
+    LruCache<IconKey, QPixmap> icons;
+    LruCache<SelectionKey, QPixmap> selections;
+    LruCache<FrameKey, QPixmap> frames;
+    LruCache<ShadowKey, QImage> shadows;  // Alpha8 nine-slice masks
+    LruCache<RowLayoutKey, RowLayout> row_layouts;
+
+    void clear();
+
+    /// Evicts least recently used entries until all categories together cost at most bytes.
+    /// The bytes are distributed proportionally to the category budgets.
+    void trim(qsizetype bytes);
+
+    /// Returns the hit, miss and eviction counters of all categories.
+    QString report() const;
+
+private:
+
+    RenderCache();
+
+};
@@ -1,13 +1,28 @@
 // Copyright (c) 2022-2025 Manuel Schneider
 
+#include "layouttransaction.h"
 #include "primitives.h"
+#include "rendercache.h"
 #include "resizinglist.h"
 #include <QApplication>
 #include <QKeyEvent>
 #include <QPainter>
-#include <QPixmapCache>
 using namespace std;
 
+namespace {
+
+// Rows laid out per event loop iteration. Positioning a uniformly sized row is cheap and the
+// visible rows should make it into the first batch.
+const int layout_batch_size = 512;
+
+// Time the row count has to be stable before the list shrinks
+const int shrink_delay = 300;  // ms
+
+// Keys of the requests deferred by layout transactions
+enum DeferredRequest { Relayout };
+
+}
+
 ItemDelegateBase::ItemDelegateBase():
     text_font(QApplication::font()),
     text_font_metrics(text_font),
@@ -16,45 +31,80 @@ ItemDelegateBase::ItemDelegateBase():
 
 }
 
+ItemDelegateBase::~ItemDelegateBase() { invalidateSelectionPixmaps(); }
+
+void ItemDelegateBase::invalidateSelectionPixmaps()
+{
+    RenderCache::instance().selections.removeIf([this](const SelectionKey &k)
+                                                { return k.owner == this; });
+}
+
 void ItemDelegateBase::paint(QPainter *p, const QStyleOptionViewItem &opt, const QModelIndex &) const
 {
     if(opt.state.testFlag(QStyle::State_Selected))
     {
+        auto &cache = RenderCache::instance().selections;
+        const auto dpr = opt.widget->devicePixelRatioF();
+        const SelectionKey key{this, opt.rect.size(), dpr};
         QPixmap pm;
-        if (const auto cache_key = QStringLiteral("_ItemViewSelection_%1x%2")
-                                       .arg(opt.rect.width()).arg(opt.rect.height());
-            !QPixmapCache::find(cache_key, &pm))
+        if (auto *cached = cache.find(key); cached)
+            pm = *cached;
+        else
         {
-            auto dpr = opt.widget->devicePixelRatioF();
             pm = pixelPerfectRoundedRect(opt.rect.size() * dpr,
                                          selection_background_brush,
                                          (int)(selection_border_radius * dpr),
                                          selection_border_brush,
                                          (int)(selection_border_width * dpr));
             pm.setDevicePixelRatio(dpr);
-            QPixmapCache::insert(cache_key, pm);
+            cache.insert(key, pm, RenderCache::cost(pm));
         }
         p->drawPixmap(opt.rect, pm);
     }
 }
 
-ResizingList::ResizingList(QWidget *parent) : QListView(parent)
+ResizingList::ResizingList(QWidget *parent):
+    QListView(parent),
+    maxItems_(5),
+    reserve_max_height_(false),
+    shown_rows_(0),
+    row_height_(-1)
 {
+    shrink_timer_.setSingleShot(true);
+    shrink_timer_.setInterval(shrink_delay);
+    connect(&shrink_timer_, &QTimer::timeout, this, [this]{
+        shown_rows_ = targetRows();
+        updateGeometry();
+    });
+
     connect(this, &ResizingList::clicked, this, &ResizingList::activated);
 
     setEditTriggers(NoEditTriggers);
     setFrameShape(QFrame::NoFrame);
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-//    setLayoutMode(LayoutMode::Batched);
-    setUniformItemSizes(true);
+    setUniformItemSizes(true);  // item size is computed from the first row only
+    setLayoutMode(LayoutMode::Batched);  // large lists are laid out in time slices
+    setBatchSize(layout_batch_size);
     viewport()->setAutoFillBackground(false);
     hide();
 }
 
 void ResizingList::relayout()
 {
-    updateGeometry();
-    reset(); // needed to relayout items
+    // Metrics set within a transaction are applied at once
+    LayoutTransaction::request(this, Relayout, [this]{
+        // The delayed items layout recomputes the uniform item size without resetting the view
+        row_height_ = -1;
+        updateGeometry();
+        scheduleDelayedItemsLayout();
+    });
+}
+
+int ResizingList::rowHeight() const
+{
+    if (row_height_ < 0 && model() && model()->rowCount(rootIndex()) > 0)
+        row_height_ = sizeHintForRow(0);
+    return max(0, row_height_);
 }
 
 bool ResizingList::debugMode() const { return delegate()->draw_debug_overlays; }
@@ -93,7 +143,7 @@ QBrush ResizingList::selectionBackgroundBrush() const
 
 void ResizingList::setSelectionBackgroundBrush(QBrush val)
 {
-    QPixmapCache::clear();
+    delegate()->invalidateSelectionPixmaps();
     delegate()->selection_background_brush = val;
     update();
 }
@@ -103,7 +153,7 @@ QBrush ResizingList::selectionBorderBrush() const
 
 void ResizingList::setSelectionBorderBrush(QBrush val)
 {
-    QPixmapCache::clear();
+    delegate()->invalidateSelectionPixmaps();
     delegate()->selection_border_brush = val;
     update();
 }
@@ -113,7 +163,7 @@ double ResizingList::borderRadius() const
 
 void ResizingList::setBorderRadius(double val)
 {
-    QPixmapCache::clear();
+    delegate()->invalidateSelectionPixmaps();
     delegate()->selection_border_radius = val;
     update();
 }
@@ -123,7 +173,7 @@ double ResizingList::borderWidth() const
 
 void ResizingList::setBorderWidth(double val)
 {
-    QPixmapCache::clear();
+    delegate()->invalidateSelectionPixmaps();
     delegate()->selection_border_width = val;
     update();
 }
@@ -141,6 +191,18 @@ uint ResizingList::maxItems() const { return maxItems_; }
 void ResizingList::setMaxItems(uint maxItems)
 {
     maxItems_ = maxItems;
+    shrink_timer_.stop();
+    shown_rows_ = targetRows();
+    updateGeometry();
+}
+
+bool ResizingList::reserveMaxHeight() const { return reserve_max_height_; }
+
+void ResizingList::setReserveMaxHeight(bool val)
+{
+    reserve_max_height_ = val;
+    shrink_timer_.stop();
+    shown_rows_ = targetRows();
     updateGeometry();
 }
 
@@ -149,8 +211,7 @@ QSize ResizingList::sizeHint() const
     if (model() == nullptr)
         return {};
     return {width(),
-            contentsMargins().bottom() + contentsMargins().top()
-                + sizeHintForRow(0) * min(static_cast<int>(maxItems_), model()->rowCount(rootIndex()))};
+            contentsMargins().bottom() + contentsMargins().top() + rowHeight() * shown_rows_};
 }
 
 QSize ResizingList::minimumSizeHint() const { return {0,0}; }
@@ -162,28 +223,48 @@ void ResizingList::setModel(QAbstractItemModel *m)
 
     QAbstractItemView::setModel(m);
 
+    // Model swaps, e.g. to a proxy and back, are subject to the same delayed shrinking as row
+    // changes, otherwise refining while typing would resize the window on every keystroke.
     if (m != nullptr)
     {
-        current_row_count_ = m->rowCount();
         connect(m, &QAbstractItemModel::rowsInserted, this, &ResizingList::onUpdateSelectionAndSize);
+        connect(m, &QAbstractItemModel::rowsRemoved, this, &ResizingList::onUpdateSelectionAndSize);
         connect(m, &QAbstractItemModel::modelReset, this, &ResizingList::onUpdateSelectionAndSize);
         onUpdateSelectionAndSize();
     }
     else
-        current_row_count_ = 0;
-
-    updateGeometry();
+        updateHeight();
 }
 
 void ResizingList::onUpdateSelectionAndSize()
 {
-    // Trigger an update if the addes rows should increase the list size
-    if (current_row_count_ < maxItems_)
-        updateGeometry();
-
-    current_row_count_ = model()->rowCount();
+    updateHeight();
 
     // Force a selection
     if (!currentIndex().isValid())
         setCurrentIndex(model()->index(0, 0));
 }
+
+int ResizingList::targetRows() const
+{
+    if (model() == nullptr)
+        return 0;
+    else if (reserve_max_height_)
+        return (int)maxItems_;
+    else
+        return min(static_cast<int>(maxItems_), model()->rowCount(rootIndex()));
+}
+
+void ResizingList::updateHeight()
+{
+    if (const auto rows = targetRows(); rows > shown_rows_)
+    {
+        shrink_timer_.stop();
+        shown_rows_ = rows;
+        updateGeometry();
+    }
+    else if (rows < shown_rows_)
+        shrink_timer_.start();  // restarts, shrinks once stable
+    else
+        shrink_timer_.stop();
+}
@@ -3,12 +3,14 @@
 #pragma once
 #include <QListView>
 #include <QStyledItemDelegate>
+#include <QTimer>
 
 
 class ItemDelegateBase : public QStyledItemDelegate
 {
 public:
     ItemDelegateBase();
+    ~ItemDelegateBase();
 
     QFont text_font;
     QColor text_color;
@@ -21,6 +23,8 @@ public:
     int padding;
     bool draw_debug_overlays;
 
+    void invalidateSelectionPixmaps();
+
 protected:
 
     void paint(QPainter *painter, const QStyleOptionViewItem &options, const QModelIndex &index) const override;
@@ -64,6 +68,10 @@ public:
     uint maxItems() const;
     void setMaxItems(uint maxItems);
 
+    /// If set the list takes the height of maxItems rows regardless of the row count.
+    bool reserveMaxHeight() const;
+    void setReserveMaxHeight(bool);
+
     void setModel(QAbstractItemModel*) override;
 
     QSize minimumSizeHint() const override;
@@ -73,13 +81,24 @@ protected:
 
     void onUpdateSelectionAndSize();
 
+    /// Grows immediately but shrinks only once the row count has been stable for a while,
+    /// such that typing does not resize the window on every keystroke.
+    void updateHeight();
+    int targetRows() const;
+
+    /// Relayouts the items in place, keeping the selection and current index.
     void relayout();
 
+    int rowHeight() const;
+
 private:
 
     virtual ItemDelegateBase *delegate() const = 0;
 
     uint maxItems_;
-    uint current_row_count_;
+    bool reserve_max_height_;
+    int shown_rows_;  // rows the size hint accounts for
+    QTimer shrink_timer_;
+    mutable int row_height_;  // uniform, -1 if not computed yet
 
 };
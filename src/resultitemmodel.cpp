@@ -1,6 +1,8 @@
 // Copyright (c) 2022-2025 Manuel Schneider
 
+#include "rendercache.h"
 #include "resultitemmodel.h"
+#include <QCoreApplication>
 #include <QIcon>
 #include <QStringListModel>
 #include <QTimer>
@@ -14,96 +16,422 @@
 #include <albert/queryhandler.h>
 #include <albert/queryresults.h>
 #include <albert/rankitem.h>
+#include <climits>
 using enum ItemRoles;
 using namespace Qt::StringLiterals;
 using namespace albert;
 using namespace std;
 
-ResultItemsModel::ResultItemsModel(const QueryResults &r) :
-    query_results(r)
+namespace {
+
+// About a frame
+const int default_batch_latency = 16;
+
+// Rows, about a page of the list
+const int default_fetch_distance = 5;
+
+const QString empty_string;
+const QIcon empty_icon;
+
+}
+
+ResultItemsModel::ResultItemsModel(QObject *parent) :
+    QAbstractListModel(parent),
+    query_results(nullptr),
+    pending_first_(0),
+    pending_last_(0),
+    pending_destination_(0),
+    row_count_(0),
+    loading_row_(false),
+    loading_row_identifier_(u"loading_row"_s),
+    loading_row_text_(QCoreApplication::translate("ResultItemsModel", "Loading…")),
+    loading_row_icon_(u":/icons/gear"_s),
+    pending_inserts_(0),
+    changed_first_(INT_MAX),
+    changed_last_(-1)
+{
+    flush_timer_.setSingleShot(true);
+    flush_timer_.setInterval(default_batch_latency);
+    connect(&flush_timer_, &QTimer::timeout, this, &ResultItemsModel::flush);
+}
+
+const QueryResults *ResultItemsModel::results() const { return query_results; }
+
+void ResultItemsModel::rebind(const QueryResults *results)
+{
+    if (query_results == results)
+        return;
+
+    beginResetModel();
+
+    if (query_results)
+    {
+        disconnect(query_results, nullptr, this, nullptr);
+        retainRows();
+    }
+
+    flush_timer_.stop();
+    dropStaleIcons();
+    pending_inserts_ = 0;
+    changed_first_ = INT_MAX;
+    changed_last_ = -1;
+
+    query_results = results;
+    row_count_ = query_results ? (int)query_results->count() : 0;
+    loading_row_ = false;
+    forEachColumn([this](auto &c){ c.clear(); c.resize(row_count_); });
+
+    if (query_results)
+        connectResults();
+
+    endResetModel();
+}
+
+void ResultItemsModel::connectResults()
 {
-    connect(&query_results, &QueryResults::resultsAboutToBeInserted,
+    connect(query_results, &QObject::destroyed,
+            this, [this]
+            { rebind(nullptr); });
+
+    connect(query_results, &QueryResults::resultsAboutToBeInserted,
             this, [this](int first, int last)
-            { beginInsertRows({}, first, last); });
+            {
+                pending_first_ = first;
+                pending_last_ = last;
+                if (first != row_count_ + pending_inserts_)  // appends are batched
+                {
+                    flush();
+                    beginInsertRows({}, first, last);
+                }
+            });
 
-    connect(&query_results, &QueryResults::resultsInserted,
+    connect(query_results, &QueryResults::resultsInserted,
             this, [this]
-            { endInsertRows(); });
+            {
+                const auto count = pending_last_ - pending_first_ + 1;
+                if (pending_first_ == row_count_ + pending_inserts_)
+                {
+                    pending_inserts_ += count;
+                    if (row_count_ == 0)
+                        flush();  // first results appear immediately
+                    else if (!flush_timer_.isActive())
+                        flush_timer_.start();
+                }
+                else
+                {
+                    forEachColumn([&](auto &c){ c.insert(c.begin() + pending_first_, count, {}); });
+                    row_count_ += count;
+                    endInsertRows();
+                }
+            });
 
-    connect(&query_results, &QueryResults::resultsAboutToBeRemoved,
+    connect(query_results, &QueryResults::resultsAboutToBeRemoved,
             this, [this](int first, int last)
-            { beginRemoveRows({}, first, last); });
+            {
+                flush();
+                pending_first_ = first;
+                pending_last_ = last;
+                beginRemoveRows({}, first, last);
+            });
 
-    connect(&query_results, &QueryResults::resultsRemoved,
+    connect(query_results, &QueryResults::resultsRemoved,
             this, [this]
-            { endRemoveRows(); });
+            {
+                forEachColumn([this](auto &c){
+                    c.erase(c.begin() + pending_first_, c.begin() + pending_last_ + 1);
+                });
+                row_count_ -= pending_last_ - pending_first_ + 1;
+                endRemoveRows();
+            });
 
-    connect(&query_results, &QueryResults::resultsAboutToBeMoved,
+    connect(query_results, &QueryResults::resultsAboutToBeMoved,
             this, [this](int srcFirst, int srcLast, int dst)
-            { beginMoveRows({}, srcFirst, srcLast, {}, dst); });
+            {
+                flush();
+                pending_first_ = srcFirst;
+                pending_last_ = srcLast;
+                pending_destination_ = dst;
+                if (isRowMove(srcFirst, srcLast, dst))
+                    beginMoveRows({}, srcFirst, srcLast, {}, dst);
+            });
 
-    connect(&query_results, &QueryResults::resultsMoved,
+    connect(query_results, &QueryResults::resultsMoved,
             this, [this]
-            { endMoveRows(); });
+            {
+                if (!isRowMove(pending_first_, pending_last_, pending_destination_))
+                    return;
+
+                forEachColumn([this](auto &c){
+                    moveRange(c, pending_first_, pending_last_, pending_destination_);
+                });
+                endMoveRows();
+            });
 
-    connect(&query_results, &QueryResults::resultsAboutToBeReset,
+    connect(query_results, &QueryResults::resultsAboutToBeReset,
             this, [this]
-            { beginResetModel(); });
+            {
+                flush_timer_.stop();
+                pending_inserts_ = 0;
+                changed_first_ = INT_MAX;
+                changed_last_ = -1;
+                beginResetModel();
+                retainRows();
+            });
 
-    connect(&query_results, &QueryResults::resultsReset,
+    connect(query_results, &QueryResults::resultsReset,
             this, [this]
-            { endResetModel(); });
+            {
+                row_count_ = (int)query_results->count();
+                loading_row_ = false;
+                forEachColumn([this](auto &c){ c.clear(); c.resize(row_count_); });
+                endResetModel();
+            });
 
-    connect(&query_results, &QueryResults::resultChanged,
+    connect(query_results, &QueryResults::resultChanged,
             this, [this](uint idx)
-            { emit dataChanged(index(idx, 0), index(idx, 0)); });
+            {
+                if ((int)idx >= row_count_)
+                    return;  // pending insert, not fetched yet
+
+                if (valid_[idx] & TextFields)
+                {
+                    retained_rows_.remove(identifiers_[idx]);
+
+                    // Icons without source are cached by identifier, the item may have
+                    // changed its icon in place. Rows never fetched have no cached icon.
+                    if (!(valid_[idx] & IconFields) || icon_sources_[idx].isEmpty())
+                        stale_icons_.insert(identifiers_[idx]);
+                }
+                valid_[idx] = 0;
+                changed_first_ = min(changed_first_, (int)idx);
+                changed_last_ = max(changed_last_, (int)idx);
+                if (!flush_timer_.isActive())
+                    flush_timer_.start();
+            });
 }
 
-int ResultItemsModel::rowCount(const QModelIndex &) const { return (int) query_results.count(); }
+int ResultItemsModel::rowCount(const QModelIndex &) const
+{ return row_count_ + (loading_row_ ? 1 : 0); }
 
-QVariant ResultItemsModel::data(const QModelIndex &index, int role) const
+int ResultItemsModel::batchLatency() const { return flush_timer_.interval(); }
+
+void ResultItemsModel::setBatchLatency(int milliseconds) { flush_timer_.setInterval(milliseconds); }
+
+void ResultItemsModel::setLoadingRowVisible(bool visible)
 {
-    const auto &query_result = query_results[index.row()];
-    const auto &[extension, item] = query_result;
+    if (loading_row_ == visible)
+        return;
 
-    switch (role) {
+    if (visible)
+    {
+        beginInsertRows({}, row_count_, row_count_);
+        loading_row_ = true;
+        endInsertRows();
+    }
+    else
+    {
+        beginRemoveRows({}, row_count_, row_count_);
+        loading_row_ = false;
+        endRemoveRows();
+    }
+}
 
+QVariant ResultItemsModel::loadingRowData(int role) const
+{
+    switch (role) {
     case IdentifierRole:
+        return loading_row_identifier_;
+    case TextRole:
+        return loading_row_text_;
+    case IconRole:
+        return loading_row_icon_;
+    }
+    return {};
+}
+
+void ResultItemsModel::flush()
+{
+    flush_timer_.stop();
+    dropStaleIcons();
+
+    if (changed_first_ <= changed_last_)
     {
-        try {
-            return u"%1.%2"_s.arg(extension->id(), item->id());
-        } catch (const exception &e) {
-            WARN << "Exception in Item::id:" << e.what();
-        }
-        return {};
+        const auto first = changed_first_;
+        const auto last = changed_last_;
+        changed_first_ = INT_MAX;
+        changed_last_ = -1;
+        emit dataChanged(index(first, 0), index(last, 0));
     }
 
-    case TextRole:
+    if (pending_inserts_ > 0)
     {
-        try {
-            auto text = item->text();
-            text.replace(u'\n', u' ');
-            return text;
-        } catch (const exception &e) {
-            WARN << "Exception in Item::text:" << e.what();
+        beginInsertRows({}, row_count_, row_count_ + pending_inserts_ - 1);
+        row_count_ += pending_inserts_;
+        pending_inserts_ = 0;
+        forEachColumn([this](auto &c){ c.resize(row_count_); });
+        endInsertRows();
+    }
+}
+
+void ResultItemsModel::dropStaleIcons()
+{
+    if (!stale_icons_.isEmpty())
+    {
+        RenderCache::instance().icons.removeIf([this](const IconKey &k)
+                                               { return stale_icons_.contains(k.source); });
+        stale_icons_.clear();
+    }
+}
+
+void ResultItemsModel::fetchTextFields(int row) const
+{
+    const auto &[extension, item] = (*query_results)[row];
+
+    try {
+        identifiers_[row] = u"%1.%2"_s.arg(extension->id(), item->id());
+    } catch (const exception &e) {
+        WARN << "Exception in Item::id:" << e.what();
+    }
+
+    try {
+        texts_[row] = item->text();
+        texts_[row].replace(u'\n', u' ');
+        folded_texts_[row] = texts_[row].toCaseFolded();
+    } catch (const exception &e) {
+        WARN << "Exception in Item::text:" << e.what();
+    }
+
+    try {
+        subtexts_[row] = item->subtext();
+        subtexts_[row].replace(u'\n', u' ');
+    } catch (const exception &e) {
+        WARN << "Exception in Item::subtext:" << e.what();
+    }
+
+    try {
+        input_action_texts_[row] = item->inputActionText();
+    } catch (const exception &e) {
+        WARN << "Exception in Item::inputActionText:" << e.what();
+    }
+
+    valid_[row] |= TextFields;
+
+    if (auto it = retained_rows_.constFind(identifiers_[row]);
+        it != retained_rows_.cend() && it->text == texts_[row] && it->subtext == subtexts_[row])
+    {
+        if (it->valid & IconFields)
+        {
+            icons_[row] = it->icon;
+            icon_sources_[row] = it->icon_source;
         }
-        return {};
+        if (it->valid & ActionFields)
+            action_names_[row] = it->action_names;
+        valid_[row] |= it->valid & (IconFields | ActionFields);
+    }
+}
+
+void ResultItemsModel::fetchIconFields(int row) const
+{
+    const auto &[extension, item] = (*query_results)[row];
+
+    try {
+        auto icon = item->icon();
+        icon_sources_[row] = icon ? icon->toUrl() : QString{};
+        icons_[row] = Icon::qIcon(std::move(icon));
+    } catch (const exception &e) {
+        WARN << "Exception in Item::makeIcon:" << e.what();
+    }
+
+    valid_[row] |= IconFields;
+}
+
+void ResultItemsModel::fetchActionFields(int row) const
+{
+    const auto &[extension, item] = (*query_results)[row];
+
+    QStringList action_names;
+    try {
+        for (const auto &action : item->actions())
+            action_names << action.text;
+    } catch (const exception &e) {
+        WARN << "Exception in Item::actions:" << e.what();
     }
+    action_names_[row] = std::move(action_names);
 
+    valid_[row] |= ActionFields;
+}
+
+bool ResultItemsModel::textContains(int row, const QString &needle) const
+{
+    if (row >= row_count_)
+        return false;  // loading row
+
+    if (!(valid_[row] & TextFields))
+        fetchTextFields(row);
+
+    // The case sensitive search is vectorized, the case insensitive one is not
+    return folded_texts_[row].contains(needle, Qt::CaseSensitive);
+}
+
+RowView ResultItemsModel::rowView(int row) const
+{
+    if (row == row_count_ && loading_row_)
+        return {loading_row_identifier_, loading_row_text_, empty_string, empty_string,
+                loading_row_icon_};
+
+    if (!(valid_[row] & TextFields))
+        fetchTextFields(row);
+
+    if (!(valid_[row] & IconFields))
+        fetchIconFields(row);
+
+    return {identifiers_[row], texts_[row], subtexts_[row], icon_sources_[row], icons_[row]};
+}
+
+void ResultItemsModel::retainRows()
+{
+    QHash<QString, RetainedRow> rows;
+    for (int row = 0; row < row_count_; ++row)
+        if (const auto v = valid_[row]; (v & TextFields) && (v & (IconFields | ActionFields)))
+            rows.insert(identifiers_[row],
+                        {texts_[row], subtexts_[row], v,
+                         icons_[row], icon_sources_[row], action_names_[row]});
+
+    // Keep the previous generation if these results did not get displayed at all
+    if (!rows.isEmpty())
+        retained_rows_ = std::move(rows);
+}
+
+QVariant ResultItemsModel::data(const QModelIndex &index, int role) const
+{
+    const auto row = index.row();
+    if (row < 0 || row >= rowCount())
+        return {};
+    else if (row == row_count_)
+        return loadingRowData(role);
+
+    switch (role) {
+
+    case IdentifierRole:
+    case TextRole:
     case SubTextRole:
+    case InputActionRole:
     {
-        try {
-            auto text = item->subtext();
-            text.replace(u'\n', u' ');
-            return text;
-        } catch (const exception &e) {
-            WARN << "Exception in Item::subtext:" << e.what();
+        if (!(valid_[row] & TextFields))
+            fetchTextFields(row);
+
+        switch (role) {
+        case IdentifierRole: return identifiers_[row];
+        case TextRole: return texts_[row];
+        case SubTextRole: return subtexts_[row];
+        default: return input_action_texts_[row];
         }
-        return {};
     }
 
     case Qt::ToolTipRole:
     {
+        // Not snapshotted, the snapshots are flattened to a single line and tooltips are rare
+        const auto &[extension, item] = (*query_results)[row];
         try {
             const auto text = item->text();
             try {
@@ -117,57 +445,135 @@ QVariant ResultItemsModel::data(const QModelIndex &index, int role) const
         return {};
     }
 
-    case InputActionRole:
-    {
-        try {
-            return item->inputActionText();
-        } catch (const exception &e) {
-            WARN << "Exception in Item::inputActionText:" << e.what();
-        }
-        return {};
-    }
-
     case IconRole:
+    case IconSourceRole:
     {
-        try {
-            return Icon::qIcon(item->icon());
-        } catch (const exception &e) {
-            WARN << "Exception in Item::makeIcon:" << e.what();
-        }
-        return {};
+        if (!(valid_[row] & TextFields))
+            fetchTextFields(row);  // may adopt retained icon fields
+
+        if (!(valid_[row] & IconFields))
+            fetchIconFields(row);
+
+        if (role == IconRole)
+            return icons_[row];
+        return icon_sources_[row];
     }
 
     case ActionsListRole:
     {
-        if (auto it = actions_cache_.find(&query_result);
-            it != actions_cache_.end())
-            return it->second;
+        if (!(valid_[row] & TextFields))
+            fetchTextFields(row);  // may adopt retained action names
 
-        try {
-            QStringList action_names;
-            for (const auto &action : item->actions())
-                action_names << action.text;
-            // actions_cache_.emplace(make_pair(extension, item.get()), actions_cache_);
-            return action_names;
-        } catch (const exception &e) {
-            WARN << "Exception in Item::actions:" << e.what();
-        }
-        return {};
+        if (!(valid_[row] & ActionFields))
+            fetchActionFields(row);
+
+        return action_names_[row];
     }
     }
     return {};
 }
 
-MatchItemsModel::MatchItemsModel(const albert::QueryResults &results, albert::QueryExecution &execution)
-    : ResultItemsModel(results)
-    , query_execution(execution) {}
+MatchItemsModel::MatchItemsModel(QObject *parent)
+    : ResultItemsModel(parent)
+    , query_execution(nullptr)
+    , fetch_distance_(default_fetch_distance)
+{
+    // Do not block the view, e.g. while it handles a key press
+    fetch_timer_.setSingleShot(true);
+    fetch_timer_.setInterval(0);
+    connect(&fetch_timer_, &QTimer::timeout, this, [this]
+    {
+        if (query_results && query_execution && query_execution->canFetchMore())
+            query_execution->fetchMore();
+        if (!query_execution || !query_execution->isActive())
+            setLoadingRowVisible(false);  // fetched synchronously or not at all
+    });
+}
+
+void MatchItemsModel::rebind(const albert::QueryResults *results,
+                             albert::QueryExecution *execution)
+{
+    if (query_results == results)
+        return;
 
+    if (query_execution)
+        disconnect(query_execution, nullptr, this, nullptr);
+
+    query_execution = results ? execution : nullptr;
+    fetch_timer_.stop();  // scheduled for the previous execution
+    ResultItemsModel::rebind(results);
+
+    if (query_execution)
+    {
+        connect(query_execution, &QObject::destroyed,
+                this, [this]{ query_execution = nullptr; });
+        connect(query_execution, &QueryExecution::activeChanged,
+                this, &MatchItemsModel::onExecutionActiveChanged);
+    }
+}
+
+// The view calls this when it hits the end of the list, fetchAhead usually was faster
 bool MatchItemsModel::canFetchMore(const QModelIndex &) const
 {
-    return query_execution.canFetchMore();
+    return query_results && query_execution && !fetch_timer_.isActive()
+           && query_execution->canFetchMore();
 }
 
 void MatchItemsModel::fetchMore(const QModelIndex &)
 {
-    query_execution.fetchMore();
+    if (!canFetchMore({}))
+        return;
+
+    setLoadingRowVisible(true);
+    fetch_timer_.start();
+}
+
+void MatchItemsModel::fetchAhead(int row)
+{
+    if (row >= row_count_ - fetch_distance_)
+        fetchMore({});
+}
+
+int MatchItemsModel::fetchDistance() const { return fetch_distance_; }
+
+void MatchItemsModel::setFetchDistance(int rows) { fetch_distance_ = rows; }
+
+void MatchItemsModel::onExecutionActiveChanged(bool active)
+{
+    if (!active && !fetch_timer_.isActive())
+    {
+        flush();  // the rows replace the loading row
+        setLoadingRowVisible(false);
+    }
+}
+
+ActionsModel::ActionsModel(const QStringList &action_names, QObject *parent):
+    QAbstractListModel(parent),
+    action_names_(action_names)
+{}
+
+int ActionsModel::rowCount(const QModelIndex &) const { return (int)action_names_.size(); }
+
+QVariant ActionsModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() < 0 || index.row() >= rowCount() || role != TextRole)
+        return {};
+    return action_names_[index.row()];
+}
+
+RowView ActionsModel::rowView(int row) const
+{ return {empty_string, action_names_[row], empty_string, empty_string, empty_icon}; }
+
+ResultFilterModel::ResultFilterModel(QObject *parent) : QSortFilterProxyModel(parent) {}
+
+void ResultFilterModel::setNeedle(const QString &needle)
+{
+    needle_ = needle.toCaseFolded();
+    invalidateRowsFilter();
+}
+
+bool ResultFilterModel::filterAcceptsRow(int source_row, const QModelIndex &) const
+{
+    const auto *model = static_cast<const ResultItemsModel*>(sourceModel());
+    return model->textContains(source_row, needle_);
 }
@@ -2,9 +2,14 @@
 
 #pragma once
 #include <QAbstractListModel>
-#include <map>
+#include <QHash>
+#include <QIcon>
+#include <QSet>
+#include <QSortFilterProxyModel>
+#include <QTimer>
+#include <algorithm>
+#include <vector>
 namespace albert{
-class QueryResult;
 class QueryResults;
 class QueryExecution;
 }
@@ -18,23 +23,174 @@ enum ItemRoles
     InputActionRole,                ///< QString, The tab action text
     ActionsListRole,                ///< QStringList, List of action names
     ActivateActionRole,             ///< only used for setData. Activates items.
+    IconSourceRole,                 ///< QString, The icon url. Identifies icons shared by items.
     // Dont change these without changing ItemsModel::roleNames
 };
 
 
-class ResultItemsModel : public QAbstractListModel
+/// Returns false for moves which leave the order unchanged. QAbstractItemModel::beginMoveRows
+/// rejects them.
+constexpr bool isRowMove(int first, int last, int destination)
+{ return destination < first || destination > last + 1; }
+
+/// Moves the elements first to last before destination, which is in pre-move coordinates like
+/// in QAbstractItemModel::beginMoveRows.
+/// \pre isRowMove(first, last, destination)
+template<typename C>
+void moveRange(C &c, int first, int last, int destination)
+{
+    auto f = c.begin() + first;
+    auto l = c.begin() + last + 1;
+    auto d = c.begin() + destination;
+    if (d > l)
+        std::rotate(f, l, d);
+    else
+        std::rotate(d, f, l);
+}
+
+
+///
+/// Typed view of the fields of a row used for painting.
+///
+/// The references are valid until the model changes. Avoids boxing the fields into QVariants.
+///
+struct RowView
+{
+    const QString &identifier;
+    const QString &text;
+    const QString &subtext;
+    const QString &icon_source;  ///< Empty if unknown
+    const QIcon &icon;
+};
+
+
+///
+/// Models providing typed access to their rows.
+///
+/// Delegates use this if the model implements it and fall back to QModelIndex::data otherwise.
+///
+class RowViewProvider
+{
+public:
+
+    virtual RowView rowView(int row) const = 0;
+
+protected:
+
+    ~RowViewProvider() = default;
+
+};
+
+
+class ResultItemsModel : public QAbstractListModel, public RowViewProvider
 {
 public:
 
-    ResultItemsModel(const albert::QueryResults&);
+    ResultItemsModel(QObject *parent = nullptr);
+
+    const albert::QueryResults *results() const;
+
+    /// Binds the model to results. Row snapshots are kept if results did not change.
+    /// Passing nullptr unbinds the model.
+    void rebind(const albert::QueryResults *results);
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role) const override;
+    RowView rowView(int row) const override;
+
+    /// The maximum time in ms appended and changed results are held back to be batched.
+    int batchLatency() const;
+    void setBatchLatency(int milliseconds);
+
+    /// Emits the batched inserts and changes.
+    void flush();
+
+    /// Returns true if the text of row contains needle. needle has to be case folded.
+    bool textContains(int row, const QString &needle) const;
 
 protected:
 
-    const albert::QueryResults &query_results;
-    mutable std::map<const albert::QueryResult *, QStringList> actions_cache_;
+    void connectResults();
+
+    enum RowField : quint8
+    {
+        TextFields = 1,  ///< identifier, text, folded text, subtext and input action text
+        IconFields = 2,  ///< icon and icon source
+        ActionFields = 4 ///< action names
+    };
+
+    void fetchTextFields(int row) const;
+    void fetchIconFields(int row) const;
+    void fetchActionFields(int row) const;
+    void retainRows();
+    void dropStaleIcons();
+
+    /// Shows a placeholder row after the last row, e.g. while more rows are being fetched.
+    void setLoadingRowVisible(bool visible);
+    QVariant loadingRowData(int role) const;
+
+    /// Applies f to each column of the row snapshots.
+    template<typename F>
+    void forEachColumn(F f)
+    {
+        f(valid_);
+        f(identifiers_);
+        f(texts_);
+        f(folded_texts_);
+        f(subtexts_);
+        f(input_action_texts_);
+        f(icons_);
+        f(icon_sources_);
+        f(action_names_);
+    }
+
+    const albert::QueryResults *query_results;
+
+    // Row snapshots, stored as struct of arrays. Fields are fetched from the items once per
+    // row and refreshed only on QueryResults::resultChanged.
+    mutable std::vector<quint8> valid_;  // RowField flags
+    mutable std::vector<QString> identifiers_;
+    mutable std::vector<QString> texts_;
+    mutable std::vector<QString> folded_texts_;  // for case insensitive search
+    mutable std::vector<QString> subtexts_;
+    mutable std::vector<QString> input_action_texts_;
+    mutable std::vector<QIcon> icons_;
+    mutable std::vector<QString> icon_sources_;
+    mutable std::vector<QStringList> action_names_;
+
+    // Expensive fields of the rows of the previous results, adopted by rows of the current
+    // results having the same identifier, text and subtext. Incremental queries mostly
+    // return the same items.
+    struct RetainedRow
+    {
+        QString text;
+        QString subtext;
+        quint8 valid;
+        QIcon icon;
+        QString icon_source;
+        QStringList action_names;
+    };
+    mutable QHash<QString, RetainedRow> retained_rows_;
+
+    // Arguments of the structural change in progress, applied when it is done
+    int pending_first_;
+    int pending_last_;
+    int pending_destination_;
+
+    // Appends and changes are batched, such that streaming handlers do not cause a layout per
+    // item. The model lags behind the query results by pending_inserts_ rows until flushed.
+    int row_count_;  // excluding the loading row
+    bool loading_row_;
+    QString loading_row_identifier_;
+    QString loading_row_text_;
+    QIcon loading_row_icon_;
+    int pending_inserts_;
+    int changed_first_;
+    int changed_last_;
+    QTimer flush_timer_;
+
+    // Identifiers of changed rows whose icons may be cached by identifier, dropped on flush
+    QSet<QString> stale_icons_;
 
 };
 
@@ -43,13 +199,68 @@ class MatchItemsModel : public ResultItemsModel
 {
 public:
 
-    MatchItemsModel(const albert::QueryResults&, albert::QueryExecution&);
+    MatchItemsModel(QObject *parent = nullptr);
+
+    void rebind(const albert::QueryResults *results, albert::QueryExecution *execution);
 
     bool canFetchMore(const QModelIndex &) const override;
     void fetchMore(const QModelIndex &) override;
 
+    /// Fetches the next page if row is within fetchDistance rows of the end.
+    void fetchAhead(int row);
+
+    /// The distance in rows from the end at which the next page is requested.
+    int fetchDistance() const;
+    void setFetchDistance(int rows);
+
 protected:
 
-    albert::QueryExecution &query_execution;
+    void onExecutionActiveChanged(bool active);
+
+    albert::QueryExecution *query_execution;
+    int fetch_distance_;
+    QTimer fetch_timer_;  // defers fetchMore, stopped on rebind
+
+};
+
+
+///
+/// The action names of a result.
+///
+class ActionsModel : public QAbstractListModel, public RowViewProvider
+{
+public:
+
+    ActionsModel(const QStringList &action_names, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    RowView rowView(int row) const override;
+
+protected:
+
+    const QStringList action_names_;
+
+};
+
+
+///
+/// Filters the rows of a ResultItemsModel by a case insensitive substring of their text.
+///
+/// Used to refine the rows of previous results while the results of an extended query are pending.
+///
+class ResultFilterModel : public QSortFilterProxyModel
+{
+public:
+
+    ResultFilterModel(QObject *parent = nullptr);
+
+    void setNeedle(const QString &needle);
+
+protected:
+
+    bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override;
+
+    QString needle_;  // case folded
 
 };
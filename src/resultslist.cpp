@@ -1,19 +1,82 @@
 // Copyright (c) 2014-2026 Manuel Schneider
 
+#include "iconrasterizer.h"
 #include "primitives.h"
+#include "rendercache.h"
 #include "resultitemmodel.h"
 #include "resultslist.h"
-#include <QAbstractTextDocumentLayout>
 #include <QApplication>
 #include <QPainter>
-#include <QPixmapCache>
+#include <QStaticText>
 #include <albert/logging.h>
-#include <chrono>
 using namespace Qt::StringLiterals;
 using namespace albert;
-using namespace std::chrono;
 using namespace std;
 
+namespace {
+
+// Kept to not shift the established layout, which was drawn using a QTextDocument.
+const int document_margin = 4;
+
+// Most items return plain strings. Only these characters can start markup or entities.
+bool containsMarkup(const QString &s) { return s.contains(u'<') || s.contains(u'&'); }
+
+// Items sharing an icon share the pixmap. Unknown sources are not shared.
+const QString &iconSource(const RowView &row)
+{ return row.icon_source.isEmpty() ? row.identifier : row.icon_source; }
+
+// Storage for the fields of models not providing row views, e.g. proxy models
+struct RowData
+{
+    QString identifier;
+    QString text;
+    QString subtext;
+    QString icon_source;
+    QIcon icon;
+
+    RowView view() const { return {identifier, text, subtext, icon_source, icon}; }
+};
+
+RowData rowData(const QModelIndex &i)
+{
+    using enum ItemRoles;
+    return {i.data(IdentifierRole).toString(),
+            i.data(TextRole).toString(),
+            i.data(SubTextRole).toString(),
+            i.data(IconSourceRole).toString(),
+            i.data(IconRole).value<QIcon>()};
+}
+
+template<typename F>
+void withRowView(const QModelIndex &i, F f)
+{
+    if (const auto *provider = dynamic_cast<const RowViewProvider*>(i.model()); provider)
+        f(provider->rowView(i.row()));
+    else
+        f(rowData(i).view());
+}
+
+QStaticText makeStaticText(const QString &text, const QFont &font,
+                           const QFontMetrics &font_metrics, int width)
+{
+    QStaticText static_text;
+    if (containsMarkup(text))
+    {
+        static_text.setTextFormat(Qt::RichText);
+        static_text.setText(text);
+    }
+    else
+    {
+        // Plain text fast path, skips the rich text engine entirely
+        static_text.setTextFormat(Qt::PlainText);
+        static_text.setText(font_metrics.elidedText(text, Qt::ElideRight, width));
+    }
+    static_text.setPerformanceHint(QStaticText::AggressiveCaching);
+    static_text.prepare({}, font);
+    return static_text;
+}
+
+}
 
 class ResultsListDelegate : public ItemDelegateBase
 {
@@ -33,6 +96,18 @@ public:
     QSize sizeHint(const QStyleOptionViewItem &o, const QModelIndex&) const override;
     void paint(QPainter *p, const QStyleOptionViewItem &o, const QModelIndex &i) const override;
 
+    void onIconRasterized(ResultsList *list, const IconKey &key, const QImage &image);
+
+    const QPixmap *requestIcon(const RowView &row, const IconKey &key) const;
+
+    void prefetch(const QModelIndex &index, int width, qreal dpr) const;
+
+    const RowLayout &rowLayout(const QString &identifier, const QString &text,
+                               const QString &subtext, int width, qreal dpr) const;
+
+    mutable IconRasterizer icon_rasterizer;
+    mutable QMultiHash<IconKey, QPersistentModelIndex> icon_requests;  // rows waiting for icons
+
 };
 
 //--------------------------------------------------------------------------------------------------
@@ -42,6 +117,10 @@ ResultsList::ResultsList(QWidget *parent):
 {
     delegate_ = new ResultsListDelegate;
     setItemDelegate(delegate_);
+
+    connect(&delegate_->icon_rasterizer, &IconRasterizer::finished,
+            this, [this](const IconKey &key, const QImage &image)
+            { delegate_->onIconRasterized(this, key, image); });
 }
 
 ResultsList::~ResultsList() { delete delegate_; }
@@ -77,6 +156,18 @@ uint ResultsList::iconSize() const { return delegate_->icon_size; }
 
 void ResultsList::setIconSize(uint v) { delegate_->icon_size = v; relayout(); }
 
+void ResultsList::prefetch(const QModelIndex &index) const
+{
+    // The width paint gets, i.e. the width of the visual item rect. Items are of uniform size.
+    // Until the items are laid out use the width QListView gives items in list mode.
+    auto width = max(this->width(), viewport()->width()) - 2 * spacing();
+    if (model() && model()->rowCount(rootIndex()) > 0)
+        if (const auto r = visualRect(model()->index(0, 0, rootIndex())); r.isValid())
+            width = r.width();
+
+    delegate_->prefetch(index, width, devicePixelRatioF());
+}
+
 //--------------------------------------------------------------------------------------------------
 
 ResultsListDelegate::ResultsListDelegate():
@@ -86,6 +177,72 @@ ResultsListDelegate::ResultsListDelegate():
 
 }
 
+const RowLayout &ResultsListDelegate::rowLayout(const QString &identifier,
+                                                const QString &text,
+                                                const QString &subtext,
+                                                int width, qreal dpr) const
+{
+    auto &cache = RenderCache::instance().row_layouts;
+    const RowLayoutKey key{identifier, text_font, subtext_font, width, dpr};
+
+    if (auto *l = cache.find(key);
+        l && l->text == text && l->subtext == subtext)
+        return *l;
+
+    const auto elide_width = width - 2 * document_margin;  // margins on both sides
+    RowLayout l{text,
+                subtext,
+                makeStaticText(text, text_font, text_font_metrics, elide_width),
+                makeStaticText(subtext, subtext_font, subtext_font_metrics, elide_width)};
+    const auto cost = RenderCache::cost(l);
+    return cache.insert(key, std::move(l), cost);
+}
+
+void ResultsListDelegate::onIconRasterized(ResultsList *list,
+                                           const IconKey &key,
+                                           const QImage &image)
+{
+    const auto pm = QPixmap::fromImage(image);
+    RenderCache::instance().icons.insert(key, pm, RenderCache::cost(pm));
+
+    // Repaint only the rows showing this icon
+    for (const auto &index : icon_requests.values(key))
+        if (index.isValid())
+            list->update(index);
+    icon_requests.remove(key);
+}
+
+const QPixmap *ResultsListDelegate::requestIcon(const RowView &row, const IconKey &key) const
+{
+    if (auto *cached = RenderCache::instance().icons.find(key); cached)
+        return cached;
+
+    if (!icon_rasterizer.isPending(key))
+    {
+        if (row.icon.isNull())
+        {
+            WARN << "Item retured null icon:" << row.identifier;
+            return &RenderCache::instance().icons.insert(key, QPixmap(), 0);
+        }
+        else if (const auto path = IconRasterizer::imagePath(row.icon_source); !path.isNull())
+            icon_rasterizer.decode(key, path, row.icon);
+        else
+            icon_rasterizer.render(key, row.icon);  // QIcon is not thread safe
+    }
+
+    return nullptr;
+}
+
+void ResultsListDelegate::prefetch(const QModelIndex &index, int width, qreal dpr) const
+{
+    withRowView(index, [&](const RowView &row)
+    {
+        requestIcon(row, {iconSource(row), icon_size, dpr});
+        rowLayout(row.identifier, row.text, row.subtext,
+                  width - 2 * padding - icon_size - horizontal_spacing, dpr);
+    });
+}
+
 QSize ResultsListDelegate::sizeHint(const QStyleOptionViewItem &o, const QModelIndex &) const
 {
     auto width = o.widget->width();
@@ -130,41 +287,33 @@ void ResultsListDelegate::paint(QPainter *p,
                              texts_width,
                              subtext_font_metrics.height()};
 
-    QAbstractTextDocumentLayout::PaintContext ctx;
-    ctx.palette.setColor(QPalette::Text, o.widget->palette().color(
-      (o.state & QStyle::State_Selected) ? QPalette::HighlightedText : QPalette::WindowText));
+    const auto text_color = o.widget->palette().color(
+        (o.state & QStyle::State_Selected) ? QPalette::HighlightedText : QPalette::WindowText);
 
     //
     // DATA
     //
 
-    using enum ItemRoles;
-
     const auto selected = o.state.testFlag(QStyle::State_Selected);
 
+    const auto dpr = o.widget->devicePixelRatioF();
+    const auto *provider = dynamic_cast<const RowViewProvider*>(i.model());
+    RowData row_data;
+    if (!provider)
+        row_data = rowData(i);
+    const auto row = provider ? provider->rowView(i.row()) : row_data.view();
+
+    const IconKey icon_key{iconSource(row), icon_size, dpr};
     QPixmap pm;
-    if (const auto cache_key = u"%1@%2x%3"_s
-                                   .arg(i.data(IdentifierRole).toString())
-                                   .arg(icon_size)
-                                   .arg(o.widget->devicePixelRatioF());
-        !QPixmapCache::find(cache_key, &pm))
-    {
-        auto tp = system_clock::now();
-        if (const auto icon = i.data(IconRole).value<QIcon>();
-            icon.isNull())
-            WARN << "Item retured null icon:"
-                 << i.data(IdentifierRole).value<QString>();
-        else
-        {
-            pm = icon.pixmap(QSize(icon_size, icon_size), o.widget->devicePixelRatioF());
-            auto dur = duration_cast<milliseconds>(system_clock::now() - tp).count();
-            if (dur > 5)
-                WARN << u"Slow icon rendering: %1 ms - %2"_s.arg(dur).arg(icon.name());
-        }
+    if (auto *cached = requestIcon(row, icon_key); cached)
+        pm = *cached;
 
+    const auto icon_pending = icon_rasterizer.isPending(icon_key);
+    if (const QPersistentModelIndex pi(i);
+        icon_pending && !icon_requests.contains(icon_key, pi))
+        icon_requests.insert(icon_key, pi);
 
-        QPixmapCache::insert(cache_key, pm);
-    }
+    const auto &row_layout = rowLayout(row.identifier, row.text, row.subtext, texts_width, dpr);
 
     //
     // PAINT
@@ -175,32 +324,35 @@ void ResultsListDelegate::paint(QPainter *p,
     // Draw selection
     ItemDelegateBase::paint(p, o, i);
 
-    // Draw icon (such that it is centered in the icon_rect)
-    p->drawPixmap(
-        icon_rect.x() + (icon_rect.width() - (int)pm.deviceIndependentSize().width()) / 2,
-        icon_rect.y() + (icon_rect.height() - (int)pm.deviceIndependentSize().height()) / 2,
-        pm);
+    // Draw a cheap placeholder until the icon is rasterized
+    if (icon_pending)
+    {
+        auto placeholder_color = text_color;
+        placeholder_color.setAlpha(24);
+        const auto r = icon_size / 5.0;
+        p->setRenderHint(QPainter::Antialiasing, true);
+        p->setPen(Qt::NoPen);
+        p->setBrush(placeholder_color);
+        p->drawRoundedRect(icon_rect, r, r);
+    }
 
-    QTextDocument doc;
+    // Draw icon (such that it is centered in the icon_rect)
+    else
+        p->drawPixmap(
+            icon_rect.x() + (icon_rect.width() - (int)pm.deviceIndependentSize().width()) / 2,
+            icon_rect.y() + (icon_rect.height() - (int)pm.deviceIndependentSize().height()) / 2,
+            pm);
 
     // Draw text
-    doc.setDefaultFont(text_font);
-    p->translate(text_rect.left(), text_rect.top());
-    doc.setHtml(i.data(TextRole).toString());
-    doc.documentLayout()->draw(p, ctx);
-    // // Clips. Adjust by descent sice origin seems to be the baseline
-    // p->drawText(text_rect, text);
-    // p->drawText(text_rect.bottomLeft() - QPoint(0, text_font_metrics.descent() - 1), text);
+    p->setPen(text_color);
+    p->setFont(text_font);
+    p->drawStaticText(text_rect.topLeft() + QPoint(document_margin, document_margin),
+                      row_layout.static_text);
 
     // Draw subtext
-    doc.setDefaultFont(subtext_font);
-    p->translate(0, text_rect.height() - 4);
-    doc.setHtml(i.data(SubTextRole).toString());
-    doc.documentLayout()->draw(p, ctx);
-
-    // // Clips. Adjust by descent sice origin seems to be the baseline
-    // p->drawText(subtext_rect, subtext);
-    // p->drawText(subtext_rect.bottomLeft() - QPoint(0, subtext_font_metrics.descent() - 1), subtext);
+    p->setFont(subtext_font);
+    p->drawStaticText(text_rect.topLeft() + QPoint(document_margin, text_rect.height()),
+                      row_layout.static_subtext);
 
     if (draw_debug_overlays)
     {
@@ -29,6 +29,9 @@ public:
     uint verticalSpacing() const;
     void setVerticalSpacing(uint);
 
+    /// Prepares the icon and text layout of index, such that its first paint is cheap.
+    void prefetch(const QModelIndex &index) const;
+
 private:
 
     ItemDelegateBase *delegate() const override;
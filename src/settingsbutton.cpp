@@ -5,25 +5,37 @@
 #include <QMouseEvent>
 #include <QPaintEvent>
 #include <QPainter>
-#include <QPixmapCache>
 #include <QTimer>
 #include <QtSvg/QSvgRenderer>
 #include <albert/logging.h>
+#include <numbers>
 using namespace std;
 
 
+namespace {
+
+// The gear has 6 homomorphic permutations
+const double symmetry_angle = 60;
+
+// Never tick faster than ~60 fps
+const int min_frame_interval = 16;
+
+// Upper bound of the rotation frames per symmetry_angle
+const int max_frame_count = 60;
+
+}
+
 SettingsButton::SettingsButton(QWidget *parent):
     QFrame(parent),
     color(Qt::transparent),
-    rps(0)
+    rps(0),
+    angle_(0),
+    frame_index_(0),
+    frames_dpr_(0)
 {
-    // once used animations but like 10% cpu even without drawing
-    animation_timer_.setInterval(16); // ~60 fps, totally sufficient
-    connect(&animation_timer_, &QTimer::timeout, this, [this]{
-        auto degree_per_timer_interval = rps * 360 / 1000 * animation_timer_.interval();
-        angle_ = std::fmod(angle_ + degree_per_timer_interval, 60);  // gear has 6 homomorphic permutations
-        update();
-    });
+    // Ticks are scheduled only when the angle changes a frame, see updateAnimationTimer
+    animation_timer_.setTimerType(Qt::PreciseTimer);
+    connect(&animation_timer_, &QTimer::timeout, this, &SettingsButton::onAnimationTick);
 
     svg_renderer_ = std::make_unique<QSvgRenderer>(QStringLiteral(":/icons/gear"));
 
@@ -34,14 +46,33 @@ SettingsButton::SettingsButton(QWidget *parent):
 
 SettingsButton::~SettingsButton() = default;
 
+void SettingsButton::setColor(const QColor &c)
+{
+    if (color == c)
+        return;
+    color = c;
+    update();
+}
+
+void SettingsButton::setSpeed(double v)
+{
+    if (rps == v)
+        return;
+    rps = v;
+    updateAnimationTimer();
+}
+
 bool SettingsButton::event(QEvent *event)
 {
     if (event->type() == QEvent::Show)
-        animation_timer_.start();
+        updateAnimationTimer();
 
     else if (event->type() == QEvent::Hide)
         animation_timer_.stop();
 
+    else if (event->type() == QEvent::Resize)
+        updateAnimationTimer();
+
     else if (event->type() == QEvent::MouseButtonPress)
     {
         emit clicked(static_cast<QMouseEvent*>(event)->button());
@@ -51,24 +82,90 @@ bool SettingsButton::event(QEvent *event)
     return QWidget::event(event);
 }
 
+int SettingsButton::frameCount() const
+{
+    // One frame per pixel the outer edge of the gear travels
+    const auto radius = std::min(contentsRect().width(), contentsRect().height())
+                        * devicePixelRatioF() / 2;
+    return std::clamp((int)std::ceil(std::numbers::pi / 3 * radius), 1, max_frame_count);
+}
+
+int SettingsButton::frameIndex() const
+{ return (int)(angle_ / symmetry_angle * frameCount()) % frameCount(); }
+
+void SettingsButton::updateAnimationTimer()
+{
+    if (!isVisible() || rps <= 0)
+    {
+        animation_timer_.stop();
+        return;
+    }
+
+    // Duration in ms the gear needs to advance by one frame
+    const auto frame_duration = 1000. * symmetry_angle / (360. * rps * frameCount());
+    animation_timer_.setInterval(std::max(min_frame_interval, (int)frame_duration));
+
+    if (!animation_timer_.isActive())
+    {
+        animation_clock_.start();
+        animation_timer_.start();
+    }
+}
+
+void SettingsButton::onAnimationTick()
+{
+    const auto degrees = rps * 360 * animation_clock_.restart() / 1000;
+    angle_ = std::fmod(angle_ + degrees, symmetry_angle);
+
+    if (const auto index = frameIndex(); index != frame_index_)
+    {
+        frame_index_ = index;
+        update();
+    }
+}
+
+const QPixmap &SettingsButton::frame(int index)
+{
+    const auto dpr = devicePixelRatioF();
+    const auto size = contentsRect().size();
+    if (frames_size_ != size || frames_dpr_ != dpr || frames_color_ != color
+        || (int)frames_.size() != frameCount())
+    {
+        frames_.assign(frameCount(), QPixmap());
+        frames_size_ = size;
+        frames_dpr_ = dpr;
+        frames_color_ = color;
+    }
+
+    auto &pm = frames_[index];
+    if (pm.isNull())
+    {
+        pm = QPixmap(size * dpr);
+        pm.fill(Qt::transparent);
+
+        QPainter pp(&pm);
+        QRectF pixmap_rect{{}, pm.size()};
+
+        QPointF rotationOrigin = pixmap_rect.center();
+        pp.translate(rotationOrigin);
+        pp.rotate(symmetry_angle * index / frames_.size());
+        pp.translate(-rotationOrigin);
+        svg_renderer_->render(&pp);
+        pp.resetTransform();
+        pp.setCompositionMode(QPainter::CompositionMode_SourceIn);
+        pp.fillRect(pixmap_rect, color);
+        pm.setDevicePixelRatio(dpr);
+    }
+    return pm;
+}
+
 void SettingsButton::paintEvent(QPaintEvent *)
 {
-    QPixmap pm = QPixmap(contentsRect().size() * devicePixelRatioF());
-    pm.fill(Qt::transparent);
-
-    QPainter pp(&pm);
-    QRectF pixmap_rect{{}, pm.size()};
-
-    QPointF rotationOrigin = pixmap_rect.center();
-    pp.translate(rotationOrigin);
-    pp.rotate(angle_);
-    pp.translate(-rotationOrigin);
-    svg_renderer_->render(&pp);
-    pp.resetTransform();
-    pp.setCompositionMode(QPainter::CompositionMode_SourceIn);
-    pp.fillRect(pixmap_rect, color);
-    pm.setDevicePixelRatio(devicePixelRatioF());
+    if (contentsRect().isEmpty())
+        return;
+
+    frame_index_ = frameIndex();
 
     QPainter p(this);
-    p.drawPixmap(contentsRect(), pm);
+    p.drawPixmap(contentsRect(), frame(frame_index_));
 }
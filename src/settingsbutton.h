@@ -1,16 +1,18 @@
 // Copyright (c) 2022-2025 Manuel Schneider
 
 #pragma once
-#include <QTimer>
+#include <QElapsedTimer>
 #include <QFrame>
+#include <QTimer>
 #include <memory>
+#include <vector>
 class QSvgRenderer;
 
 class SettingsButton final : public QFrame
 {
     Q_OBJECT
-    Q_PROPERTY(QColor color MEMBER color)
-    Q_PROPERTY(double speed MEMBER rps)
+    Q_PROPERTY(QColor color MEMBER color WRITE setColor)
+    Q_PROPERTY(double speed MEMBER rps WRITE setSpeed)
 
 public:
 
@@ -20,14 +22,31 @@ public:
     QColor color;
     double rps;
 
+    void setColor(const QColor &color);
+    void setSpeed(double rps);
+
 private:
 
     void paintEvent(QPaintEvent *event) override;
     bool event(QEvent *event) override;
 
+    void onAnimationTick();
+    void updateAnimationTimer();
+    int frameCount() const;
+    int frameIndex() const;
+    const QPixmap &frame(int index);
+
     std::unique_ptr<QSvgRenderer> svg_renderer_;
     QTimer animation_timer_;
+    QElapsedTimer animation_clock_;
     double angle_;
+    int frame_index_;
+
+    // Lazily rendered ring of tinted rotation frames, valid for the size, dpr and color below
+    std::vector<QPixmap> frames_;
+    QSize frames_size_;
+    qreal frames_dpr_;
+    QColor frames_color_;
 
 signals:
 
@@ -4,6 +4,8 @@
 #include "debugoverlay.h"
 #include "frame.h"
 #include "inputline.h"
+#include "layouttransaction.h"
+#include "rendercache.h"
 #include "resizinglist.h"
 #include "resultitemmodel.h"
 #include "resultslist.h"
@@ -17,11 +19,9 @@
 #include <QDir>
 #include <QKeyEvent>
 #include <QMenu>
-#include <QPixmapCache>
 #include <QPropertyAnimation>
 #include <QSettings>
 #include <QStateMachine>
-#include <QStringListModel>
 #include <QStyleFactory>
 #include <QTimer>
 #include <QWindow>
@@ -48,6 +48,8 @@ const double settings_button_rps_busy = 0.5;
 const unsigned settings_button_rps_animation_duration = 0;
 const unsigned settings_button_fade_animation_duration = 0;
 const unsigned settings_button_highlight_animation_duration = 0;
+const auto render_cache_trim_delay = 60s;  // after hide
+const int action_prefetch_distance = 2;  // rows around the current one
 
 const struct {
 
@@ -68,6 +70,9 @@ const struct {
     const char*     theme_dark                                  = "Default System Palette";
     const char*     theme_light                                 = "Default System Palette";
     const uint      max_results                                 = 5;
+    const uint      render_cache_retention                      = 8;  // MiB
+    const bool      local_refinement                            = false;
+    const bool      reserve_results_height                      = false;
 
     const uint      general_spacing                             = 6;
 
@@ -140,6 +145,9 @@ const struct {
     const char *theme_dark                             = "darkTheme";
     const char *theme_light                            = "lightTheme";
     const char *disable_input_method                   = "disable_input_method";
+    const char *render_cache_retention                 = "render_cache_retention";
+    const char *local_refinement                       = "local_refinement";
+    const char *reserve_results_height                 = "reserve_results_height";
 
     const char* window_shadow_size                     = "window_shadow_size";
     const char* window_shadow_offset                   = "window_shadow_offset";
@@ -215,9 +223,14 @@ Window::Window(PluginInstance &p) :
     settings_button(new SettingsButton(input_frame)),
     results_list(new ResultsList(this)),
     actions_list(new ActionsList(this)),
+    match_items_model_(new MatchItemsModel(this)),
+    fallback_items_model_(new ResultItemsModel(this)),
+    refinement_model_(new ResultFilterModel(this)),
     dark_mode(haveDarkSystemPalette()),
     current_query{nullptr},
-    edit_mode_(false)
+    edit_mode_(false),
+    render_cache_retention_(defaults.render_cache_retention),
+    local_refinement_(defaults.local_refinement)
 {
     initializeUi();
     initializeProperties();
@@ -235,13 +248,38 @@ Window::Window(PluginInstance &p) :
     connect(settings_button, &SettingsButton::clicked,
             this, &Window::onSettingsButtonClick);
 
-    QPixmapCache::setCacheLimit(1024 * 50);  // 50 MB
+    // Keep the caches warm across hide/show, but release memory if unused for a while
+    render_cache_trim_timer_.setSingleShot(true);
+    render_cache_trim_timer_.setInterval(render_cache_trim_delay);
+    connect(&render_cache_trim_timer_, &QTimer::timeout, this, [this]{
+        RenderCache::instance().trim(render_cache_retention_ * 1024 * 1024);
+    });
+
+    // Prepare the actions of the current item when idle, such that showing them is a swap
+    action_prefetch_timer_.setSingleShot(true);
+    action_prefetch_timer_.setInterval(0);
+    connect(&action_prefetch_timer_, &QTimer::timeout, this, &Window::prefetchActions);
+    connect(match_items_model_, &QAbstractItemModel::dataChanged,
+            this, &Window::onResultsDataChanged);
+    connect(fallback_items_model_, &QAbstractItemModel::dataChanged,
+            this, &Window::onResultsDataChanged);
+
+    // Prepare the fallbacks of finished queries when idle, such that showing them is instant
+    fallback_warm_timer_.setSingleShot(true);
+    fallback_warm_timer_.setInterval(0);
+    connect(&fallback_warm_timer_, &QTimer::timeout, this, &Window::warmFallbacks);
+    connect(this, &Window::queryActiveChanged, this, [this](bool active){
+        if (active)
+            fallback_warm_timer_.stop();
+        else
+            fallback_warm_timer_.start();
+    });
 
     // Warm up call to prevent UI freeze (~50ms) on first use
     Icon::grapheme(u"🔥"_s)->pixmap(QSize(32, 32), 1);
 }
 
-Window::~Window() {}
+Window::~Window() { RenderCache::instance().clear(); }  // Pixmaps must not outlive the app
 
 void Window::initializeUi()
 {
@@ -315,6 +353,7 @@ void Window::initializeUi()
 
 void Window::initializeProperties()
 {
+    LayoutTransaction transaction(this);
     auto s = plugin.settings();
     setAlwaysOnTop(
         s->value(keys.always_on_top,
@@ -346,6 +385,15 @@ void Window::initializeProperties()
     setDebugMode(
         s->value(keys.debug,
                  defaults.debug).toBool());
+    setRenderCacheRetention(
+        s->value(keys.render_cache_retention,
+                 defaults.render_cache_retention).toUInt());
+    setLocalRefinement(
+        s->value(keys.local_refinement,
+                 defaults.local_refinement).toBool());
+    setReserveResultsHeight(
+        s->value(keys.reserve_results_height,
+                 defaults.reserve_results_height).toBool());
 
 
     setWindowShadowSize(
@@ -526,6 +574,17 @@ static void setModelMemorySafe(QAbstractItemView *v, QAbstractItemModel *m)
         delete dm;
 }
 
+// Like setModelMemorySafe but for pooled models, which outlive the view assignment
+static void setPooledModel(QAbstractItemView *v, QAbstractItemModel *m)
+{
+    if (v->model() == m)
+        return;
+    auto sm = v->selectionModel();
+    v->setModel(m);
+    if (sm)
+        delete sm;
+}
+
 inline static bool isActive(detail::Query *query) { return query && query->execution().isActive(); }
 
 inline static bool isGlobal(detail::Query *query) { return query &&query->trigger().isEmpty(); }
@@ -713,6 +772,11 @@ void Window::initializeStatemachine()
 
     addTransition(s_results_disabled, s_results_hidden, display_delay_timer, &QTimer::timeout);
 
+    // Reenter to show all previous matches delayed if the query no longer extends them
+    addTransition(s_results_disabled, s_results_disabled, this, &Window::queryChanged,
+                  [this]{ return current_query && results_list->model() == refinement_model_
+                                 && refinement_needle_.isEmpty(); });
+
     addTransition(s_results_disabled, s_results_hidden, this, &Window::queryActiveChanged,
                   [this]{ return !isActive(current_query) && (!hasFallbacks(current_query) || !isGlobal(current_query)); });
 
@@ -809,24 +873,45 @@ void Window::initializeStatemachine()
     QObject::connect(s_results_hidden, &QState::entered, this, [this]{
         keyboard_navigation_receiver = nullptr;
         results_list->hide();
-        setModelMemorySafe(results_list, nullptr);
+        setPooledModel(results_list, nullptr);
+        match_items_model_->rebind(nullptr, nullptr);
+        fallback_items_model_->rebind(nullptr);
+        discardPrefetchedActions();
     });
 
     QObject::connect(s_results_disabled, &QState::entered, this, [this, display_delay_timer]{
         // disable user interaction withough using enabled property (flickers)
         results_list->setAttribute(Qt::WA_TransparentForMouseEvents, true);
         keyboard_navigation_receiver = nullptr;
-        display_delay_timer->start();
+
+        // Show the previous matches containing the extended query until the new ones arrive.
+        // Fallbacks do not contain the query usually, refining them would blank the list.
+        if (results_list->model() == match_items_model_ && !refinement_needle_.isEmpty())
+        {
+            refinement_model_->setSourceModel(match_items_model_);
+            refinement_model_->setNeedle(refinement_needle_);
+            setPooledModel(results_list, refinement_model_);
+        }
+        else
+            display_delay_timer->start();
     });
 
-    QObject::connect(s_results_disabled, &QState::exited, this, [this]{
+    QObject::connect(s_results_disabled, &QState::exited, this, [this, display_delay_timer]{
         // enable user interaction withough using enabled property (flickers)
         results_list->setAttribute(Qt::WA_TransparentForMouseEvents, false);
+        display_delay_timer->stop();
+
+        // Detach the refinement, do not filter the pooled models while they are rebound
+        if (results_list->model() == refinement_model_)
+            setPooledModel(results_list, match_items_model_);
+        refinement_model_->setSourceModel(nullptr);
     });
 
     QObject::connect(s_results_matches, &QState::entered, this, [this]{
         keyboard_navigation_receiver = results_list;
-        setModelMemorySafe(results_list, new MatchItemsModel(current_query->matches(), current_query->execution()));
+        match_items_model_->rebind(&current_query->matches(), &current_query->execution());
+        setPooledModel(results_list, match_items_model_);
+        watchActionPrefetch();
 
         connect(results_list, &ResizingList::activated, this, &Window::onMatchActivation);
         connect(actions_list, &ResizingList::activated, this, &Window::onMatchActionActivation);
@@ -835,7 +920,10 @@ void Window::initializeStatemachine()
         connect(results_list->selectionModel(), &QItemSelectionModel::currentChanged,
                 this, [this](const QModelIndex &current, const QModelIndex&) {
             if (current.isValid())
+            {
                 input_line->setCompletion(current.data(ItemRoles::InputActionRole).toString());
+                match_items_model_->fetchAhead(current.row());
+            }
         });
 
         // Initialize if we have a selected item
@@ -849,13 +937,18 @@ void Window::initializeStatemachine()
     });
 
     QObject::connect(s_results_matches, &QState::exited, this, [this]{
+        // The selection model may be reused on reentry
+        disconnect(results_list->selectionModel(), &QItemSelectionModel::currentChanged,
+                   this, nullptr);
         disconnect(results_list, &ResizingList::activated, this, &Window::onMatchActivation);
         disconnect(actions_list, &ResizingList::activated, this, &Window::onMatchActionActivation);
     });
 
     QObject::connect(s_results_fallbacks, &QState::entered, this, [this]{
         keyboard_navigation_receiver = results_list;
-        setModelMemorySafe(results_list, new ResultItemsModel(current_query->fallbacks()));
+        fallback_items_model_->rebind(&current_query->fallbacks());
+        setPooledModel(results_list, fallback_items_model_);
+        watchActionPrefetch();
 
         connect(results_list, &ResizingList::activated, this, &Window::onFallbackActivation);
         connect(actions_list, &ResizingList::activated, this, &Window::onFallbackActionActivation);
@@ -870,10 +963,14 @@ void Window::initializeStatemachine()
 
     QObject::connect(s_actions_visible, &QState::entered, this, [this]{
         keyboard_navigation_receiver = actions_list;
-        auto m = new QStringListModel(results_list->currentIndex().data(ItemRoles::ActionsListRole)
-                                     .toStringList(),
-                                 actions_list);  // takes ownership
-        setModelMemorySafe(actions_list, m);
+        ActionsModel *m;
+        if (prefetched_actions_ && prefetched_actions_index_ == results_list->currentIndex())
+            m = prefetched_actions_.release();
+        else
+            m = new ActionsModel(results_list->currentIndex().data(ItemRoles::ActionsListRole)
+                                     .toStringList());
+        discardPrefetchedActions();
+        setModelMemorySafe(actions_list, m);  // takes ownership
         actions_list->show();
     });
 
@@ -897,6 +994,69 @@ void Window::installEventFilterKeepThisPrioritized(QObject *watched, QObject *fi
     watched->installEventFilter(this);
 }
 
+void Window::watchActionPrefetch()
+{
+    discardPrefetchedActions();
+
+    // Connections die with the selection model, which may be reused though
+    connect(results_list->selectionModel(), &QItemSelectionModel::currentChanged,
+            &action_prefetch_timer_, qOverload<>(&QTimer::start), Qt::UniqueConnection);
+
+    action_prefetch_timer_.start();
+}
+
+void Window::onResultsDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (prefetched_actions_index_.isValid()
+        && prefetched_actions_index_.model() == topLeft.model()
+        && topLeft.row() <= prefetched_actions_index_.row()
+        && prefetched_actions_index_.row() <= bottomRight.row())
+    {
+        discardPrefetchedActions();
+        action_prefetch_timer_.start();
+    }
+}
+
+void Window::prefetchActions()
+{
+    const auto current = results_list->currentIndex();
+    if (!current.isValid())
+        return;
+
+    if (!prefetched_actions_ || prefetched_actions_index_ != current)
+    {
+        prefetched_actions_ = make_unique<ActionsModel>(
+            current.data(ItemRoles::ActionsListRole).toStringList());
+        prefetched_actions_index_ = current;
+    }
+
+    // Warm the neighbours, the selection is likely to move there next
+    const auto *model = current.model();
+    const auto last = min(model->rowCount() - 1, current.row() + action_prefetch_distance);
+    for (auto row = max(0, current.row() - action_prefetch_distance); row <= last; ++row)
+        if (row != current.row())
+            model->index(row, 0).data(ItemRoles::ActionsListRole);
+}
+
+void Window::discardPrefetchedActions()
+{
+    action_prefetch_timer_.stop();
+    prefetched_actions_.reset();
+    prefetched_actions_index_ = {};
+}
+
+void Window::warmFallbacks()
+{
+    if (!current_query || isActive(current_query))
+        return;
+
+    fallback_items_model_->rebind(&current_query->fallbacks());
+
+    const auto rows = min(fallback_items_model_->rowCount(), (int)maxResults());
+    for (int row = 0; row < rows; ++row)
+        results_list->prefetch(fallback_items_model_->index(row, 0));
+}
+
 void Window::postCustomEvent(EventType event_type)
 { state_machine->postEvent(new Event(event_type)); } // takes ownership
 
@@ -916,7 +1076,8 @@ void Window::onSettingsButtonClick(Qt::MouseButton button)
 
 void Window::onMatchActivation(const QModelIndex &index)
 {
-    if (index.isValid())
+    // The loading row is not a result
+    if (index.isValid() && index.row() < (int)current_query->matches().count())
         if (auto should_hide = current_query->matches().activate(index.row(), 0);
             should_hide != QGuiApplication::queryKeyboardModifiers().testFlag(Qt::ShiftModifier))
             hide();
@@ -924,7 +1085,8 @@ void Window::onMatchActivation(const QModelIndex &index)
 
 void Window::onMatchActionActivation(const QModelIndex &index)
 {
-    if (index.isValid())
+    if (index.isValid()
+        && results_list->currentIndex().row() < (int)current_query->matches().count())
         if (auto should_hide = current_query->matches().activate(results_list->currentIndex().row(),
                                                                  index.row());
             should_hide != QGuiApplication::queryKeyboardModifiers().testFlag(Qt::ShiftModifier))
@@ -954,6 +1116,20 @@ void Window::setInput(const QString &text) { input_line->setText(text); }
 
 void Window::setQuery(detail::Query *q)
 {
+    // Local refinement applies if the query extends the previous one of the same handler
+    refinement_needle_.clear();
+    if (local_refinement_ && current_query && q
+        && &current_query->handler() == &q->handler()
+        && current_query->trigger() == q->trigger()
+        && q->query().size() > current_query->query().size()
+        && q->query().startsWith(current_query->query()))
+        refinement_needle_ = q->query();
+
+    // Keep refining while typing on. Queries not extending the previous one reenter the
+    // disabled state, see the state machine.
+    if (results_list->model() == refinement_model_ && !refinement_needle_.isEmpty())
+        refinement_model_->setNeedle(refinement_needle_);
+
     if(current_query)
     {
         disconnect(&current_query->matches(), nullptr, this, nullptr);
@@ -1018,7 +1194,8 @@ void Window::applyTheme(const QString& name)
 
 void Window::applyTheme(const Theme &theme)
 {
-    QPixmapCache::clear();
+    // The setters invalidate the affected render cache entries. Layout and repaint are done once.
+    LayoutTransaction transaction(this);
 
     setPalette(theme.palette);
 
@@ -1094,6 +1271,7 @@ bool Window::event(QEvent *event)
         raise();
         activateWindow();
 #endif
+        render_cache_trim_timer_.stop();
         emit visibleChanged(true);
     }
 
@@ -1102,7 +1280,10 @@ bool Window::event(QEvent *event)
         plugin.state()->setValue(keys.window_position, pos());
 
         setEditModeEnabled(false);
-        QPixmapCache::clear();
+
+        if (debugMode())
+            DEBG << qPrintable(RenderCache::instance().report());
+        render_cache_trim_timer_.start();
 
         emit visibleChanged(false);
     }
@@ -1114,9 +1295,15 @@ bool Window::event(QEvent *event)
         QApplication::setPalette(QApplication::style()->standardPalette());
 #endif
         dark_mode = haveDarkSystemPalette();
+        RenderCache::instance().clear();  // e.g. the icon theme may have changed
         applyTheme((dark_mode) ? theme_dark_ : theme_light_);
     }
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 6, 0)
+    else if (event->type() == QEvent::DevicePixelRatioChange)
+        RenderCache::instance().clear();
+#endif
+
     else if (event->type() == QEvent::Close)
         hide();
 
@@ -1535,6 +1722,36 @@ void Window::setEditModeEnabled(bool v)
     }
 }
 
+uint Window::renderCacheRetention() const { return render_cache_retention_; }
+void Window::setRenderCacheRetention(uint val)
+{
+    if (renderCacheRetention() != val)
+    {
+        render_cache_retention_ = val;
+        plugin.settings()->setValue(keys.render_cache_retention, val);
+    }
+}
+
+bool Window::localRefinement() const { return local_refinement_; }
+void Window::setLocalRefinement(bool val)
+{
+    if (localRefinement() != val)
+    {
+        local_refinement_ = val;
+        plugin.settings()->setValue(keys.local_refinement, val);
+    }
+}
+
+bool Window::reserveResultsHeight() const { return results_list->reserveMaxHeight(); }
+void Window::setReserveResultsHeight(bool val)
+{
+    if (reserveResultsHeight() != val)
+    {
+        results_list->setReserveMaxHeight(val);
+        plugin.settings()->setValue(keys.reserve_results_height, val);
+    }
+}
+
 bool Window::disableInputMethod() const { return input_line->disable_input_method_; }
 void Window::setDisableInputMethod(bool val)
 {
@@ -3,6 +3,7 @@
 #pragma once
 #include "windowframe.h"
 #include <QEvent>
+#include <QPersistentModelIndex>
 #include <QPoint>
 #include <QTimer>
 #include <QWidget>
@@ -11,10 +12,12 @@ class PluginInstance;
 namespace detail { class Query; }
 }
 class ActionDelegate;
+class ActionsModel;
 class ActionsList;
 class DebugOverlay;
 class Frame;
 class InputLine;
+class MatchItemsModel;
 class ItemDelegate;
 class Plugin;
 class QEvent;
@@ -24,6 +27,7 @@ class QListView;
 class QPropertyAnimation;
 class QSpacerItem;
 class QStateMachine;
+class ResultFilterModel;
 class ResultItemsModel;
 class ResultsList;
 class SettingsButton;
@@ -65,6 +69,11 @@ private:
     void onMatchActionActivation(const QModelIndex &);
     void onFallbackActivation(const QModelIndex &);
     void onFallbackActionActivation(const QModelIndex &);
+    void watchActionPrefetch();
+    void prefetchActions();
+    void discardPrefetchedActions();
+    void onResultsDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void warmFallbacks();
 
     bool event(QEvent *event) override;
     bool eventFilter(QObject *watched, QEvent *event) override;
@@ -78,6 +87,10 @@ private:
     SettingsButton *settings_button;
     ResultsList *results_list;
     ActionsList *actions_list;
+    MatchItemsModel *match_items_model_;  // pooled, rebound per query
+    ResultItemsModel *fallback_items_model_;  // pooled, rebound per query
+    ResultFilterModel *refinement_model_;  // refines the previous results while disabled
+    QString refinement_needle_;  // set if the query extends the previous one
     bool dark_mode;
 
     albert::detail::Query *current_query;
@@ -101,6 +114,13 @@ private:
     std::unique_ptr<DebugOverlay> debug_overlay_;
     std::unique_ptr<QPropertyAnimation> color_animation_;
     std::unique_ptr<QPropertyAnimation> speed_animation_;
+    QTimer render_cache_trim_timer_;
+    uint render_cache_retention_;
+    bool local_refinement_;
+    QTimer action_prefetch_timer_;
+    std::unique_ptr<ActionsModel> prefetched_actions_;  // of prefetched_actions_index_
+    QPersistentModelIndex prefetched_actions_index_;
+    QTimer fallback_warm_timer_;
 
     enum EventType {
         ShowActions = QEvent::User,
@@ -169,6 +189,14 @@ public:
     bool editModeEnabled() const;
     void setEditModeEnabled(bool v);
 
+    uint renderCacheRetention() const;  // MiB
+    void setRenderCacheRetention(uint);
+
+    bool localRefinement() const;
+    void setLocalRefinement(bool);
+
+    bool reserveResultsHeight() const;
+    void setReserveResultsHeight(bool);
 
     uint windowShadowSize() const;
     void setWindowShadowSize(uint);
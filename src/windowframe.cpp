@@ -1,9 +1,45 @@
 // Copyright (c) 2023-2025 Manuel Schneider
 
+#include "boxblur.h"
 #include "primitives.h"
+#include "rendercache.h"
 #include "windowframe.h"
 #include <QPaintEvent>
-#include <QPixmapCache>
+
+namespace {
+
+// Blurs a rounded rect which is just large enough that the blurred corners do not affect a one
+// pixel wide straight edge in between. Any larger shadow can be composed by stretching the edges.
+// The size is 2 * corner + 1 where corner = 2 * blur + radius (margin, inner blur and radius).
+QImage makeShadowMask(int radius, int blur)
+{
+    const auto side = 2 * (blur + radius) + 1;
+    QImage img(side + 2 * blur, side + 2 * blur, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::transparent);
+    QPainter p(&img);
+    p.drawPixmap(blur, blur, pixelPerfectRoundedRect({side, side}, Qt::black, radius));
+    p.end();
+    auto mask = img.convertToFormat(QImage::Format_Alpha8);
+    boxBlurAlpha8(mask, blur, true);
+    return mask;
+}
+
+void drawNineSlice(QPainter &p, const QRectF &target, const QPixmap &pm, int corner_px)
+{
+    const auto c = corner_px / pm.devicePixelRatio();
+    const qreal tx[] = {target.left(), target.left() + c, target.right() - c};
+    const qreal ty[] = {target.top(), target.top() + c, target.bottom() - c};
+    const qreal tw[] = {c, target.width() - 2 * c, c};
+    const qreal th[] = {c, target.height() - 2 * c, c};
+    const qreal sx[] = {0, (qreal)corner_px, (qreal)corner_px + 1};  // also y
+    const qreal sw[] = {(qreal)corner_px, 1, (qreal)corner_px};  // also height
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            p.drawPixmap(QRectF(tx[i], ty[j], tw[i], th[j]), pm,
+                         QRectF(sx[i], sx[j], sw[i], sw[j]));
+}
+
+}
 
 
 WindowFrame::WindowFrame(QWidget *parent):
@@ -22,63 +58,137 @@ WindowFrame::WindowFrame(QWidget *parent):
     connect(this, &WindowFrame::shadowBrushChanged, this, &WindowFrame::onPropertiesChanged);
 }
 
+WindowFrame::~WindowFrame() { invalidateCache(); }
 
 void WindowFrame::paintEvent(QPaintEvent *event)
 {
     // CRIT << "Window::paintEvent" << event->rect();
 
-    QPixmap pm;
+    const auto dpr = devicePixelRatioF();
+    const auto radius_px = (int)(radius() * dpr);
+    const auto blur_px = (int)(shadow_size_ * dpr);
+    const auto corner_px = 2 * blur_px + radius_px;
+    const auto s = (qreal)shadow_size_;
+    const auto shadow_rect = QRectF(contentsRect().translated(0, shadow_offset_))
+                                 .marginsAdded({s, s, s, s});
+
+    QPainter p(this);
 
-    if (!QPixmapCache::find(cacheKey(), &pm))
+    // No shadow, the body covers it
+    if (shadow_size_ == 0 && shadow_offset_ == 0)
+        p.drawPixmap(contentsRect().topLeft(), bodyPixmap(dpr));
+
+    // Compose the shadow from the nine-slice, such that resizes do not require a blur. The
+    // slices are tinted in mask coordinates, which is only equivalent for solid brushes.
+    else if (shadow_size_ > 0
+             && shadow_brush_.style() == Qt::SolidPattern
+             && shadow_rect.width() * dpr >= 2 * corner_px + 1
+             && shadow_rect.height() * dpr >= 2 * corner_px + 1)
     {
-        auto dpr = devicePixelRatioF();
-
-        auto frame_pixmap = pixelPerfectRoundedRect(contentsRect().size() * dpr,
-                                                    fillBrush(),
-                                                    (int)(radius() * dpr),
-                                                    borderBrush(),
-                                                    (int)(borderWidth() * dpr));
-        frame_pixmap.setDevicePixelRatio(dpr);
-        // WARN << "FRAME >>>" << frame_pixmap.size() << frame_pixmap.deviceIndependentSize() << frame_pixmap.devicePixelRatio();
-
-        QImage img(size() * dpr, QImage::Format_ARGB32_Premultiplied);
-        img.setDevicePixelRatio(dpr);
-        img.fill(Qt::transparent);
-        // WARN << "IMAGE >>>" << img.size() << img.deviceIndependentSize() << img.devicePixelRatio();
-
-        auto shadow_rect = contentsRect().translated(0, shadow_offset_);
-
-        QPainter img_painter(&img);
-        img_painter.drawPixmap(shadow_rect, frame_pixmap);
-        img_painter.setCompositionMode(QPainter::CompositionMode_SourceIn);
-        img_painter.fillRect(shadow_rect, shadow_brush_);
-        img_painter.end();
-
-        pm = QPixmap(size() * dpr);
-        pm.fill(Qt::transparent);
-        pm.setDevicePixelRatio(dpr);
-
-        QPainter pm_painter(&pm);
-        pm_painter.save(); // needed qt_blurImage changes painter
-        qt_blurImage(&pm_painter, img, shadow_size_ * dpr, true, false);
-        pm_painter.restore();
-        pm_painter.drawPixmap(contentsRect().topLeft(), frame_pixmap);
-        // WARN << "COMPOSITE >>>" << pm.size() << pm.deviceIndependentSize() << pm.devicePixelRatio();
-
-        QPixmapCache::insert(cacheKey(), pm);
+        drawNineSlice(p, shadow_rect, shadowPixmap(radius_px, blur_px, dpr), corner_px);
+        p.drawPixmap(contentsRect().topLeft(), bodyPixmap(dpr));
     }
 
-    QPainter p(this);
-    p.drawPixmap(0, 0, pm);
+    // Gradients, textures, unblurred offset shadows or too small to be composed from the
+    // nine-slice
+    else
+        p.drawPixmap(0, 0, compositePixmap(dpr));
+
     event->accept();
 }
 
-QString WindowFrame::cacheKey() const {
- return QStringLiteral("_WindowFrame_%1x%2").arg(width()).arg(height()); }
+QPixmap WindowFrame::bodyPixmap(qreal dpr) const
+{
+    auto &cache = RenderCache::instance().frames;
+    const FrameKey key{this, FrameKey::Body, contentsRect().size(), dpr};
+
+    if (auto *cached = cache.find(key); cached)
+        return *cached;
+
+    auto pm = pixelPerfectRoundedRect(contentsRect().size() * dpr,
+                                      fillBrush(),
+                                      (int)(radius() * dpr),
+                                      borderBrush(),
+                                      (int)(borderWidth() * dpr));
+    pm.setDevicePixelRatio(dpr);
+    return cache.insert(key, pm, RenderCache::cost(pm));
+}
+
+QPixmap WindowFrame::shadowPixmap(int radius, int blur, qreal dpr) const
+{
+    auto &cache = RenderCache::instance();
+    const FrameKey key{this, FrameKey::Shadow, {}, dpr};
+
+    if (auto *cached = cache.frames.find(key); cached)
+        return *cached;
+
+    // The blurred mask is independent of the brush and shared by all frames
+    const ShadowKey mask_key{radius, blur, dpr};
+    const QImage *mask = cache.shadows.find(mask_key);
+    if (!mask)
+    {
+        auto m = makeShadowMask(radius, blur);
+        const auto cost = RenderCache::cost(m);
+        mask = &cache.shadows.insert(mask_key, std::move(m), cost);
+    }
+
+    QImage img(mask->size(), QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::transparent);
+    QPainter p(&img);
+    p.fillRect(img.rect(), shadow_brush_);
+    p.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+    p.drawImage(0, 0, *mask);
+    p.end();
+
+    auto pm = QPixmap::fromImage(img);
+    pm.setDevicePixelRatio(dpr);
+    return cache.frames.insert(key, pm, RenderCache::cost(pm));
+}
+
+QPixmap WindowFrame::compositePixmap(qreal dpr) const
+{
+    auto &cache = RenderCache::instance().frames;
+    const FrameKey key{this, FrameKey::Composite, size(), dpr};
+
+    if (auto *cached = cache.find(key); cached)
+        return *cached;
+
+    const auto frame_pixmap = bodyPixmap(dpr);
+
+    QImage img(size() * dpr, QImage::Format_ARGB32_Premultiplied);
+    img.setDevicePixelRatio(dpr);
+    img.fill(Qt::transparent);
+
+    auto shadow_rect = contentsRect().translated(0, shadow_offset_);
+
+    QPainter img_painter(&img);
+    img_painter.drawPixmap(shadow_rect, frame_pixmap);
+    img_painter.setCompositionMode(QPainter::CompositionMode_SourceIn);
+    img_painter.fillRect(shadow_rect, shadow_brush_);
+    img_painter.end();
+
+    QPixmap pm(size() * dpr);
+    pm.fill(Qt::transparent);
+    pm.setDevicePixelRatio(dpr);
+
+    QPainter pm_painter(&pm);
+    pm_painter.save(); // needed qt_blurImage changes painter
+    qt_blurImage(&pm_painter, img, shadow_size_ * dpr, true, false);
+    pm_painter.restore();
+    pm_painter.drawPixmap(contentsRect().topLeft(), frame_pixmap);
+    pm_painter.end();
+
+    return cache.insert(key, pm, RenderCache::cost(pm));
+}
+
+void WindowFrame::invalidateCache()
+{
+    RenderCache::instance().frames.removeIf([this](const FrameKey &k){ return k.owner == this; });
+}
 
 void WindowFrame::onPropertiesChanged()
 {
-    QPixmapCache::remove(cacheKey());
+    invalidateCache();
     update();
 }
 
@@ -122,15 +232,3 @@ void WindowFrame::setShadowBrush(QBrush val)
     shadow_brush_ = val;
     emit shadowBrushChanged(val);
 }
-
-bool WindowFrame::event(QEvent *event)
-{
-    switch (event->type()) {
-    case QEvent::Resize:
-        QPixmapCache::remove(cacheKey());
-        break;
-    default:
-        break;
-    }
-    return Frame::event(event);
-}
@@ -2,6 +2,7 @@
 
 #pragma once
 #include "frame.h"
+#include "rendercache.h"
 #include <QWidget>
 
 class WindowFrame : public Frame
@@ -14,6 +15,7 @@ class WindowFrame : public Frame
 public:
 
     WindowFrame(QWidget *parent = nullptr);
+    ~WindowFrame();
 
     uint shadowSize() const;
     void setShadowSize(uint val);
@@ -26,9 +28,11 @@ public:
 
 protected:
 
-    bool event(QEvent *event) override;
     void paintEvent(QPaintEvent *event) override;
-    QString cacheKey() const;
+    QPixmap bodyPixmap(qreal dpr) const;
+    QPixmap shadowPixmap(int radius, int blur, qreal dpr) const;
+    QPixmap compositePixmap(qreal dpr) const;
+    void invalidateCache();
     void onPropertiesChanged();
 
     uint shadow_size_;
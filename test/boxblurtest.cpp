@@ -0,0 +1,118 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "boxblur.h"
+#include "primitives.h"
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <random>
+using namespace std;
+
+namespace {
+
+QImage randomMask(int width, int height, unsigned seed = 0)
+{
+    QImage image(width, height, QImage::Format_Alpha8);
+    mt19937 gen(seed);
+    uniform_int_distribution<int> dist(0, 255);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            image.bits()[y * image.bytesPerLine() + x] = (uchar)dist(gen);
+    return image;
+}
+
+// Compares the pixels, ignoring the padding at the end of the lines
+bool equalPixels(const QImage &a, const QImage &b)
+{
+    if (a.width() != b.width() || a.height() != b.height())
+        return false;
+    for (int y = 0; y < a.height(); ++y)
+        if (memcmp(a.constBits() + y * a.bytesPerLine(),
+                   b.constBits() + y * b.bytesPerLine(), a.width()) != 0)
+            return false;
+    return true;
+}
+
+QImage blurred(QImage image, int radius, bool parallel, BoxBlurKernel kernel)
+{
+    boxBlurAlpha8(image, radius, parallel, kernel);
+    return image;
+}
+
+}
+
+TEST_CASE("Vectorized kernels match the scalar kernel")
+{
+    auto kernel = GENERATE(BoxBlurKernel::Sse2, BoxBlurKernel::Avx2);
+    if (!boxBlurKernelSupported(kernel))
+        return;
+
+    // Widths which are not a multiple of the vector width exercise the scalar tails
+    auto width = GENERATE(1, 7, 8, 15, 17, 31, 33, 100, 257);
+    auto height = GENERATE(1, 9, 40);
+    auto radius = GENERATE(1, 2, 3, 5, 8, 13, 40);
+
+    const auto image = randomMask(width, height, (unsigned)(width * 31 + height));
+    INFO("width " << width << ", height " << height << ", radius " << radius);
+    CHECK(equalPixels(blurred(image, radius, false, BoxBlurKernel::Scalar),
+                      blurred(image, radius, false, kernel)));
+}
+
+TEST_CASE("Parallel strips match the serial blur")
+{
+    // Large enough to be split into strips, widths not a multiple of the strip alignment
+    auto width = GENERATE(300, 700, 1001);
+    auto radius = GENERATE(1, 9, 40);
+
+    const auto image = randomMask(width, 300, (unsigned)width);
+    INFO("width " << width << ", radius " << radius);
+    CHECK(equalPixels(blurred(image, radius, false, BoxBlurKernel::Scalar),
+                      blurred(image, radius, true, BoxBlurKernel::Auto)));
+}
+
+TEST_CASE("Opaque areas stay opaque")
+{
+    QImage image(200, 200, QImage::Format_Alpha8);
+    image.fill(0);
+    for (int y = 50; y < 150; ++y)
+        memset(image.bits() + y * image.bytesPerLine() + 50, 255, 100);
+
+    boxBlurAlpha8(image, 10);
+
+    CHECK(image.constBits()[100 * image.bytesPerLine() + 100] == 255);
+    CHECK(image.constBits()[100 * image.bytesPerLine() + 5] == 0);
+}
+
+TEST_CASE("Box blur benchmark", "[!benchmark]")
+{
+    const auto size = GENERATE(QSize(256, 256), QSize(1024, 768), QSize(2048, 2048));
+    const auto radius = GENERATE(8, 40, 80, 160);
+
+    const auto image = randomMask(size.width(), size.height());
+
+    // The window frame shadow used to be blurred by Qt
+    const auto argb = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    DYNAMIC_SECTION(size.width() << "x" << size.height() << ", radius " << radius)
+    {
+        BENCHMARK("qt_blurImage")
+        {
+            auto src = argb;
+            QImage dst(src.size(), QImage::Format_ARGB32_Premultiplied);
+            dst.fill(Qt::transparent);
+            QPainter p(&dst);
+            qt_blurImage(&p, src, radius, true, false);
+            return dst;
+        };
+
+        BENCHMARK("scalar") { return blurred(image, radius, false, BoxBlurKernel::Scalar); };
+
+        if (boxBlurKernelSupported(BoxBlurKernel::Sse2))
+            BENCHMARK("sse2") { return blurred(image, radius, false, BoxBlurKernel::Sse2); };
+
+        if (boxBlurKernelSupported(BoxBlurKernel::Avx2))
+            BENCHMARK("avx2") { return blurred(image, radius, false, BoxBlurKernel::Avx2); };
+
+        BENCHMARK("auto, parallel") { return blurred(image, radius, true, BoxBlurKernel::Auto); };
+    }
+}
@@ -0,0 +1,14 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#define CATCH_CONFIG_RUNNER
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <QApplication>
+
+int main(int argc, char *argv[])
+{
+    // Widgets are laid out but never shown
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+    QApplication app(argc, argv);
+    return Catch::Session().run(argc, argv);
+}
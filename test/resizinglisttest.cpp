@@ -0,0 +1,181 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "resizinglist.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QPainter>
+#include <QScrollBar>
+#include <QSet>
+#include <QStringListModel>
+#include <catch2/catch.hpp>
+using namespace Qt::StringLiterals;
+
+namespace {
+
+// Reads the text in paint, like the delegates of the plugin
+class TextDelegate : public ItemDelegateBase
+{
+public:
+
+    void paint(QPainter *p, const QStyleOptionViewItem &o, const QModelIndex &i) const override
+    {
+        ItemDelegateBase::paint(p, o, i);
+        p->drawText(o.rect, i.data().toString());
+    }
+
+};
+
+// Records the rows whose data has been read
+class CountingModel : public QStringListModel
+{
+public:
+
+    using QStringListModel::QStringListModel;
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        ++reads;
+        read_rows.insert(index.row());
+        return QStringListModel::data(index, role);
+    }
+
+    void resetCounts() const { reads = 0; read_rows.clear(); }
+
+    mutable int reads = 0;
+    mutable QSet<int> read_rows;
+
+};
+
+class List : public ResizingList
+{
+public:
+
+    List(QAbstractItemModel *m, LayoutMode mode)
+    {
+        // Not initialized by the delegate, set by the theme usually
+        delegate_.selection_border_radius = 4;
+        delegate_.selection_border_width = 1;
+        delegate_.padding = 4;
+
+        setItemDelegate(&delegate_);
+        setLayoutMode(mode);
+        resize(400, 300);
+        setModel(m);
+        show();
+    }
+
+    // Processes events until the last row has been laid out
+    bool waitForLayout()
+    {
+        const auto last = model()->index(model()->rowCount() - 1, 0);
+        QElapsedTimer timer;
+        timer.start();
+        while (!visualRect(last).isValid() && timer.elapsed() < 10000)
+            QCoreApplication::processEvents();
+        return visualRect(last).isValid();
+    }
+
+private:
+
+    ItemDelegateBase *delegate() const override { return &delegate_; }
+    mutable TextDelegate delegate_;
+
+};
+
+QStringList makeStrings(int rows)
+{
+    QStringList strings;
+    for (int i = 0; i < rows; ++i)
+        strings << u"Item %1"_s.arg(i);
+    return strings;
+}
+
+QStringListModel *makeModel(int rows) { return new QStringListModel(makeStrings(rows)); }
+
+// Scrolls to value and paints the viewport synchronously
+void scrollAndRender(List &list, int value)
+{
+    list.verticalScrollBar()->setValue(value);
+    list.viewport()->repaint();
+}
+
+}
+
+TEST_CASE("Batched layout yields the geometry of a single pass layout")
+{
+    const auto rows = GENERATE(1, 511, 512, 513, 5000);
+    std::unique_ptr<QStringListModel> model(makeModel(rows));
+
+    List batched(model.get(), QListView::Batched);
+    List single(model.get(), QListView::SinglePass);
+    CHECK(batched.batchSize() == 512);
+
+    REQUIRE(batched.waitForLayout());
+    REQUIRE(single.waitForLayout());
+
+    for (int row = 0; row < rows; ++row)
+    {
+        const auto index = model->index(row, 0);
+        INFO("row " << row);
+        REQUIRE(batched.visualRect(index) == single.visualRect(index));
+    }
+    CHECK(batched.sizeHint() == single.sizeHint());
+}
+
+TEST_CASE("Large list layout benchmark", "[!benchmark]")
+{
+    std::unique_ptr<QStringListModel> model(makeModel(100000));
+    List batched(model.get(), QListView::Batched);
+    List single(model.get(), QListView::SinglePass);
+
+    BENCHMARK("single pass") { single.doItemsLayout(); };
+    BENCHMARK("batched, first batch") { batched.doItemsLayout(); };
+}
+
+TEST_CASE("Scrolling reads the visible rows only")
+{
+    CountingModel model(makeStrings(10000));
+    List list(&model, QListView::Batched);
+    REQUIRE(list.waitForLayout());
+
+    auto *bar = list.verticalScrollBar();
+    REQUIRE(bar->maximum() > 0);
+
+    for (const auto value : {bar->maximum() / 4, bar->maximum() / 2, bar->maximum(), 0})
+    {
+        model.resetCounts();
+        scrollAndRender(list, value);
+
+        const auto first = list.indexAt(list.viewport()->rect().topLeft()).row();
+        auto last = list.indexAt(list.viewport()->rect().bottomLeft()).row();
+        if (last < 0)
+            last = model.rowCount() - 1;
+        REQUIRE(first >= 0);
+
+        INFO("scroll value " << value << ", visible rows " << first << "-" << last);
+        CHECK(model.reads > 0);
+        for (const auto row : model.read_rows)
+        {
+            // Row 0 provides the uniform item size, one row of tolerance for partial rows
+            INFO("read row " << row);
+            CHECK((row == 0 || (row >= first - 1 && row <= last + 1)));
+        }
+    }
+}
+
+TEST_CASE("Scroll and render benchmark", "[!benchmark]")
+{
+    CountingModel model(makeStrings(10000));
+    List list(&model, QListView::Batched);
+    REQUIRE(list.waitForLayout());
+
+    auto *bar = list.verticalScrollBar();
+    int value = 0;
+
+    BENCHMARK("per frame")
+    {
+        value = (value + 3 * bar->singleStep()) % (bar->maximum() + 1);
+        scrollAndRender(list, value);
+    };
+}
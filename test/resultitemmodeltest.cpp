@@ -0,0 +1,81 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "resultitemmodel.h"
+#include <catch2/catch.hpp>
+#include <numeric>
+using namespace std;
+
+namespace {
+
+vector<int> iota(int n)
+{
+    vector<int> v(n);
+    std::iota(v.begin(), v.end(), 0);
+    return v;
+}
+
+}
+
+TEST_CASE("Moves leaving the order unchanged are no moves")
+{
+    CHECK_FALSE(isRowMove(2, 4, 2));
+    CHECK_FALSE(isRowMove(2, 4, 3));
+    CHECK_FALSE(isRowMove(2, 4, 4));
+    CHECK_FALSE(isRowMove(2, 4, 5));  // directly after the last row
+    CHECK(isRowMove(2, 4, 1));
+    CHECK(isRowMove(2, 4, 6));
+}
+
+TEST_CASE("Ranges are moved before the destination")
+{
+    SECTION("Down")
+    {
+        auto v = iota(8);
+        moveRange(v, 1, 2, 6);
+        CHECK(v == vector<int>{0, 3, 4, 5, 1, 2, 6, 7});
+    }
+
+    SECTION("Down to the end")
+    {
+        auto v = iota(5);
+        moveRange(v, 0, 1, 5);
+        CHECK(v == vector<int>{2, 3, 4, 0, 1});
+    }
+
+    SECTION("Up")
+    {
+        auto v = iota(8);
+        moveRange(v, 4, 6, 1);
+        CHECK(v == vector<int>{0, 4, 5, 6, 1, 2, 3, 7});
+    }
+
+    SECTION("Up to the front")
+    {
+        auto v = iota(5);
+        moveRange(v, 4, 4, 0);
+        CHECK(v == vector<int>{4, 0, 1, 2, 3});
+    }
+
+    SECTION("Matches QAbstractItemModel semantics for all moves")
+    {
+        // Reference: remove the range and insert it before destination in pre-move coordinates
+        const int n = 6;
+        for (int first = 0; first < n; ++first)
+            for (int last = first; last < n; ++last)
+                for (int dst = 0; dst <= n; ++dst)
+                    if (isRowMove(first, last, dst))
+                    {
+                        auto v = iota(n);
+                        moveRange(v, first, last, dst);
+
+                        auto expected = iota(n);
+                        vector<int> range(expected.begin() + first, expected.begin() + last + 1);
+                        expected.erase(expected.begin() + first, expected.begin() + last + 1);
+                        const auto insert_at = dst > last ? dst - (last - first + 1) : dst;
+                        expected.insert(expected.begin() + insert_at, range.begin(), range.end());
+
+                        INFO(first << " " << last << " " << dst);
+                        CHECK(v == expected);
+                    }
+    }
+}